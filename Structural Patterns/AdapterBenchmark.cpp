@@ -0,0 +1,199 @@
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+#if defined(__GLIBC__)
+#include <malloc.h>
+#endif
+#include "Benchmark.h"
+#include "Shape.h"
+using namespace std;
+
+/**
+ * Class adapter vs. object adapter.
+ *
+ *     AdapterBenchmark [--json results.json]
+ *
+ * Builds a million text shapes of each kind the way DrawingEditor would,
+ * one heap object per shape (plus one per TextView for the object
+ * adapter), and reports:
+ *
+ *   - the layout of each adapter and the heap it really takes per shape,
+ *     allocator overhead included, where glibc can tell;
+ *   - BoundingBox and IsEmpty throughput with a hot cache: the same
+ *     HotCount shapes over and over;
+ *   - the same with a cold cache: every shape once, in shuffled order,
+ *     after evicting the caches before each pass.
+ *
+ * Every sixteenth shape has no width, so IsEmpty is not a constant.
+ */
+
+static const size_t Count = size_t(1) << 20;
+static const size_t HotCount = 1024;
+static const size_t EvictBytes = size_t(64) << 20;
+
+// Bytes the heap has handed out, or 0 where it cannot tell.
+static size_t heapInUse()
+{
+#if defined(__GLIBC__) && (__GLIBC__ > 2 || (__GLIBC__ == 2 && __GLIBC_MINOR__ >= 33))
+  return mallinfo2().uordblks;
+#else
+  return 0;
+#endif
+}
+
+struct Adapter
+{
+  string name;
+  size_t objectBytes;    // sizeof the shape plus what it points to
+  double heapPerShape;   // measured, 0 if unknown
+  vector<Shape *> shapes;
+  vector<TextView *> views;
+  double ns[4];          // hot/cold BoundingBox, hot/cold IsEmpty, per shape
+};
+
+static Coord widthOf(size_t i) { return i % 16 ? Coord(10 + i % 7) : 0; }
+
+static void buildClassAdapters(Adapter &adapter)
+{
+  adapter.name = "class";
+  adapter.objectBytes = sizeof(ClassAdapter::TextShape);
+  adapter.shapes.reserve(Count);
+  size_t before = heapInUse();
+  for (size_t i = 0; i < Count; ++i)
+    adapter.shapes.push_back(new ClassAdapter::TextShape(Coord(i % 1000), Coord(i / 1000), widthOf(i), 20));
+  size_t after = heapInUse();
+  adapter.heapPerShape = after ? double(after - before) / Count : 0;
+}
+
+static void buildObjectAdapters(Adapter &adapter)
+{
+  adapter.name = "object";
+  adapter.objectBytes = sizeof(ObjectAdapter::TextShape) + sizeof(TextView);
+  adapter.shapes.reserve(Count);
+  adapter.views.reserve(Count);
+  size_t before = heapInUse();
+  for (size_t i = 0; i < Count; ++i)
+  {
+    adapter.views.push_back(new TextView(Coord(i % 1000), Coord(i / 1000), widthOf(i), 20));
+    adapter.shapes.push_back(new ObjectAdapter::TextShape(adapter.views.back()));
+  }
+  size_t after = heapInUse();
+  adapter.heapPerShape = after ? double(after - before) / Count : 0;
+}
+
+static void destroy(Adapter &adapter)
+{
+  for (Shape *shape : adapter.shapes)
+    delete shape;
+  for (TextView *view : adapter.views)
+    delete view;
+}
+
+static void measure(BenchmarkSuite &suite, Adapter &adapter, const vector<size_t> &order, vector<char> &evict)
+{
+  vector<Shape *> shuffled;
+  shuffled.reserve(Count);
+  for (size_t i : order)
+    shuffled.push_back(adapter.shapes[i]);
+  const Shape *const *shapes = shuffled.data();
+
+  auto evictCaches = [&] {
+    for (size_t i = 0; i < evict.size(); i += 64)
+      ++evict[i];
+    doNotOptimize(evict.data());
+  };
+
+  auto boundingBoxes = [](const Shape *const *shapes, size_t count) {
+    Coord sum = 0;
+    for (size_t i = 0; i < count; ++i)
+    {
+      Point bottomLeft, topRight;
+      shapes[i]->BoundingBox(bottomLeft, topRight);
+      sum += topRight.x;
+    }
+    doNotOptimize(sum);
+  };
+  auto emptyCount = [](const Shape *const *shapes, size_t count) {
+    size_t empty = 0;
+    for (size_t i = 0; i < count; ++i)
+      empty += shapes[i]->IsEmpty();
+    doNotOptimize(empty);
+  };
+
+  const string prefix = "adapter/" + adapter.name + "/";
+  adapter.ns[0] = suite.run(prefix + "BoundingBox/hot", [&] { boundingBoxes(shapes, HotCount); }).medianNs / HotCount;
+  adapter.ns[1] = suite.run(prefix + "BoundingBox/cold", [&] { boundingBoxes(shapes, Count); }, evictCaches).medianNs / Count;
+  adapter.ns[2] = suite.run(prefix + "IsEmpty/hot", [&] { emptyCount(shapes, HotCount); }).medianNs / HotCount;
+  adapter.ns[3] = suite.run(prefix + "IsEmpty/cold", [&] { emptyCount(shapes, Count); }, evictCaches).medianNs / Count;
+}
+
+static void report(const Adapter *adapters, size_t count)
+{
+  printf("\nLayout: sizeof Shape %zu, TextView %zu, ClassAdapter::TextShape %zu, ObjectAdapter::TextShape %zu\n",
+         sizeof(Shape), sizeof(TextView), sizeof(ClassAdapter::TextShape), sizeof(ObjectAdapter::TextShape));
+  printf("\n%-8s %12s %12s %14s %14s %14s %14s\n", "adapter", "bytes/shape", "heap/shape",
+         "bbox hot ns", "bbox cold ns", "empty hot ns", "empty cold ns");
+  for (size_t i = 0; i < count; ++i)
+  {
+    const Adapter &a = adapters[i];
+    char heap[32] = "n/a";
+    if (a.heapPerShape > 0)
+      snprintf(heap, sizeof(heap), "%.1f", a.heapPerShape);
+    printf("%-8s %12zu %12s %14.2f %14.2f %14.2f %14.2f\n", a.name.c_str(), a.objectBytes, heap,
+           a.ns[0], a.ns[1], a.ns[2], a.ns[3]);
+  }
+  printf("\nns are per shape, from the median sample; %zu shapes cold, %zu hot.\n", Count, HotCount);
+}
+
+int main(int argc, char *argv[])
+{
+  const char *jsonPath = nullptr;
+  for (int i = 1; i < argc; ++i)
+  {
+    if (strcmp(argv[i], "--json") == 0 && i + 1 < argc)
+      jsonPath = argv[++i];
+    else
+    {
+      cerr << "usage: " << argv[0] << " [--json results.json]\n";
+      return 2;
+    }
+  }
+
+  BenchmarkSuite suite("adapter");
+  if (!suite.hasCounters())
+    cerr << "hardware counters unavailable, reporting time only\n";
+
+  vector<size_t> order(Count);
+  for (size_t i = 0; i < Count; ++i)
+    order[i] = i;
+  shuffle(order.begin(), order.end(), mt19937(42));
+  vector<char> evict(EvictBytes);
+
+  // One adapter at a time, so that each is measured on a heap of its own.
+  Adapter adapters[2];
+  buildClassAdapters(adapters[0]);
+  measure(suite, adapters[0], order, evict);
+  destroy(adapters[0]);
+  buildObjectAdapters(adapters[1]);
+  measure(suite, adapters[1], order, evict);
+  destroy(adapters[1]);
+
+  report(adapters, 2);
+
+  if (jsonPath)
+  {
+    ofstream json(jsonPath);
+    suite.writeJson(json);
+    if (!json)
+    {
+      cerr << "could not write " << jsonPath << "\n";
+      return 1;
+    }
+  }
+  return 0;
+}
@@ -0,0 +1,175 @@
+#ifndef ANY_BACKPACK_H
+#define ANY_BACKPACK_H
+
+#include <cstddef>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include "Backpack.h"
+#include "StaticBackpack.h"
+
+/**
+ * Backpack by value.
+ *
+ * AnyBackpack holds any IBackpack by value and is itself copyable and
+ * movable, like std::function holds any callable. Objects of up to
+ * Capacity bytes that can be moved without throwing are stored inside
+ * the handle, so creating, copying and moving them never touches the
+ * allocator. That covers PlainBackpack, Decorated<> and the concrete
+ * decorators, which hold a component pointer and a signature memo (24
+ * bytes on a 64-bit host); the asserts after the class keep it so.
+ * Anything larger goes on the heap.
+ *
+ *     PlainBackpack plain;
+ *     AnyBackpack backpack = WithLaptopSlot(&plain);
+ *     AnyBackpack copy = backpack;
+ *     copy->assemble();
+ *
+ * Copying a decorator copies the decorator, not what it decorates: both
+ * copies wrap the same component.
+ */
+class AnyBackpack
+{
+public:
+  static const std::size_t Capacity = 4 * sizeof(void *);
+
+  AnyBackpack() noexcept : m_Ops(nullptr), m_Object(nullptr) {}
+
+  template <class T, class = typename std::enable_if<
+                         std::is_base_of<IBackpack, typename std::decay<T>::type>::value>::type>
+  AnyBackpack(T &&value) : m_Ops(nullptr), m_Object(nullptr)
+  {
+    typedef typename std::decay<T>::type Type;
+    if constexpr (storesInline<Type>())
+      m_Object = new (m_Buffer) Type(std::forward<T>(value));
+    else
+      m_Object = new Type(std::forward<T>(value));
+    m_Ops = &opsFor<Type>();
+  }
+
+  AnyBackpack(const AnyBackpack &other) : m_Ops(nullptr), m_Object(nullptr)
+  {
+    if (other.m_Ops)
+    {
+      other.m_Ops->copy(other, *this);
+      m_Ops = other.m_Ops;
+    }
+  }
+
+  AnyBackpack(AnyBackpack &&other) noexcept : m_Ops(nullptr), m_Object(nullptr)
+  {
+    take(other);
+  }
+
+  AnyBackpack &operator=(const AnyBackpack &other)
+  {
+    if (this != &other)
+    {
+      AnyBackpack copy(other);
+      reset();
+      take(copy);
+    }
+    return *this;
+  }
+
+  AnyBackpack &operator=(AnyBackpack &&other) noexcept
+  {
+    if (this != &other)
+    {
+      reset();
+      take(other);
+    }
+    return *this;
+  }
+
+  ~AnyBackpack() { reset(); }
+
+  IBackpack *get() const { return m_Object; }
+  IBackpack *operator->() const { return m_Object; }
+  IBackpack &operator*() const { return *m_Object; }
+  explicit operator bool() const { return m_Object != nullptr; }
+
+  // Whether the held object lives inside the handle.
+  bool isInline() const { return m_Ops && m_Ops->isInline; }
+
+  // Whether a T would live inside the handle.
+  template <class T>
+  static constexpr bool storesInline()
+  {
+    return sizeof(T) <= Capacity && alignof(T) <= alignof(std::max_align_t) &&
+           std::is_nothrow_move_constructible<T>::value;
+  }
+
+  void reset() noexcept
+  {
+    if (m_Ops)
+      m_Ops->destroy(*this);
+    m_Ops = nullptr;
+    m_Object = nullptr;
+  }
+
+private:
+  struct Ops
+  {
+    void (*copy)(const AnyBackpack &from, AnyBackpack &to);
+    void (*move)(AnyBackpack &from, AnyBackpack &to) noexcept;
+    void (*destroy)(AnyBackpack &self) noexcept;
+    bool isInline;
+  };
+
+  template <class T>
+  static const Ops &opsFor()
+  {
+    static const Ops ops = {
+        [](const AnyBackpack &from, AnyBackpack &to) {
+          const T &object = *static_cast<const T *>(from.m_Object);
+          if constexpr (storesInline<T>())
+            to.m_Object = new (to.m_Buffer) T(object);
+          else
+            to.m_Object = new T(object);
+        },
+        [](AnyBackpack &from, AnyBackpack &to) noexcept {
+          T *object = static_cast<T *>(from.m_Object);
+          if constexpr (storesInline<T>())
+          {
+            to.m_Object = new (to.m_Buffer) T(std::move(*object));
+            object->~T();
+          }
+          else
+            to.m_Object = object;
+        },
+        [](AnyBackpack &self) noexcept {
+          T *object = static_cast<T *>(self.m_Object);
+          if constexpr (storesInline<T>())
+            object->~T();
+          else
+            delete object;
+        },
+        storesInline<T>()};
+    return ops;
+  }
+
+  void take(AnyBackpack &other) noexcept
+  {
+    if (other.m_Ops)
+    {
+      other.m_Ops->move(other, *this);
+      m_Ops = other.m_Ops;
+      other.m_Ops = nullptr;
+      other.m_Object = nullptr;
+    }
+  }
+
+  const Ops *m_Ops;
+  IBackpack *m_Object;
+  alignas(std::max_align_t) unsigned char m_Buffer[Capacity];
+};
+
+static_assert(AnyBackpack::storesInline<PlainBackpack>(), "PlainBackpack is stored inline");
+static_assert(AnyBackpack::storesInline<WithLaptopSlot>(), "WithLaptopSlot is stored inline");
+static_assert(AnyBackpack::storesInline<WithUSBCharge>(), "WithUSBCharge is stored inline");
+static_assert(AnyBackpack::storesInline<WithWaterBottle>(), "WithWaterBottle is stored inline");
+static_assert(AnyBackpack::storesInline<Decorated<PlainBackpack, LaptopSlot, USBCharge, WaterBottle> >(),
+              "Decorated<> is stored inline");
+
+#endif // ANY_BACKPACK_H
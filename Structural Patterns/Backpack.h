@@ -0,0 +1,226 @@
+#ifndef BACKPACK_H
+#define BACKPACK_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <iostream>
+#include <string>
+
+/**
+ * An append-only buffer that backpacks can be assembled into.
+ *
+ * Writing each layer straight to cout goes through the stream's
+ * formatting machinery once per layer. A sink only appends bytes, so a
+ * whole batch of assemblies ends up in one contiguous buffer that is
+ * written out with a single call.
+ */
+class BackpackSink
+{
+public:
+  explicit BackpackSink(std::size_t reserve = 0) { m_Buffer.reserve(reserve); }
+
+  void append(const char *text) { m_Buffer.append(text); }
+  void append(const std::string &text) { m_Buffer.append(text); }
+  void append(const char *text, std::size_t length) { m_Buffer.append(text, length); }
+
+  const std::string &str() const { return m_Buffer; }
+  std::size_t size() const { return m_Buffer.size(); }
+  void reserve(std::size_t n) { m_Buffer.reserve(n); }
+  void clear() { m_Buffer.clear(); }
+
+  void writeTo(std::ostream &os) const
+  {
+    os.write(m_Buffer.data(), static_cast<std::streamsize>(m_Buffer.size()));
+  }
+
+private:
+  std::string m_Buffer;
+};
+
+class BackpackDecorator;
+
+class IBackpack
+{
+public:
+  virtual void assemble() = 0;
+  virtual void assemble(BackpackSink &sink) = 0;
+  virtual ~IBackpack() {}
+
+  /**
+   * This node as a BackpackDecorator, or nullptr if it is not one.
+   * Cheaper than dynamic_cast for code that walks a chain.
+   */
+  virtual BackpackDecorator *asDecorator() { return nullptr; }
+};
+
+// A plain backpack only has shoulder straps.
+class PlainBackpack : public IBackpack
+{
+public:
+  static constexpr const char *label = "\n ShoulderStraps and mainCompartment";
+
+  virtual void assemble()
+  {
+    std::cout << label;
+  }
+  virtual void assemble(BackpackSink &sink)
+  {
+    sink.append(label);
+  }
+};
+
+/**
+ * Now, let's decorate the PlainBackpack.
+ *
+ * IBackpack object is used to delegate the implementation of
+ * the assemble() method depending on the type of m_decorator.
+ */
+class BackpackDecorator : public IBackpack
+{
+public:
+  BackpackDecorator(IBackpack *decorator) : m_Decorator(decorator), m_Signature(0) {}
+  // noexcept, so that AnyBackpack can keep decorators inline.
+  BackpackDecorator(const BackpackDecorator &other) noexcept : m_Decorator(other.m_Decorator), m_Signature(0) {}
+  BackpackDecorator &operator=(const BackpackDecorator &other)
+  {
+    setComponent(other.m_Decorator);
+    return *this;
+  }
+
+  virtual void assemble()
+  {
+    m_Decorator->assemble();
+  }
+  virtual void assemble(BackpackSink &sink)
+  {
+    m_Decorator->assemble(sink);
+  }
+
+  virtual BackpackDecorator *asDecorator() { return this; }
+
+  // The component this decorator wraps.
+  IBackpack *component() const { return m_Decorator; }
+  void setComponent(IBackpack *component)
+  {
+    m_Decorator = component;
+    shapeEpoch().fetch_add(1, std::memory_order_relaxed);
+  }
+
+  /**
+   * Bumped whenever any chain is relinked with setComponent(), so that
+   * what was memoized about the shape of a chain (see signature()) can
+   * tell it may be stale.
+   */
+  static std::atomic<std::uint32_t> &shapeEpoch()
+  {
+    static std::atomic<std::uint32_t> epoch(1);
+    return epoch;
+  }
+
+  /**
+   * Room for BackpackCache to memoize the signature of the chain below
+   * and including this decorator, together with the shapeEpoch() it was
+   * computed in. Zero until first computed; a copy starts at zero.
+   */
+  std::atomic<std::uint64_t> &signature() const { return m_Signature; }
+
+  /**
+   * The text this decorator appends after its component, or nullptr if
+   * it does something other than append text. Lets a chain be inspected
+   * without running it.
+   */
+  virtual const char *label() const { return nullptr; }
+
+private:
+  IBackpack *m_Decorator;
+  mutable std::atomic<std::uint64_t> m_Signature;
+};
+
+/**
+ * Features.
+ *
+ * The three features as plain tag types, each carrying only the text it
+ * adds. Every other spelling of a feature refers to these labels: the
+ * concrete decorators below append them, and code that inspects a chain
+ * (BackpackBatch, BackpackCache) can compare label pointers rather than
+ * text. The tag types also let a chain be decided at compile time
+ * instead (see StaticBackpack.h).
+ */
+struct LaptopSlot
+{
+  static constexpr const char *label = " + LaptopSlot";
+};
+
+struct USBCharge
+{
+  static constexpr const char *label = " + USBCharge";
+};
+
+struct WaterBottle
+{
+  static constexpr const char *label = " + WaterBottle";
+};
+
+/**
+ * Concrete Decorators.
+ *
+ * Below three concrete Decorators are all identical apart from
+ * the feature they add.
+ *
+ * The first, adds a laptopSlot;
+ * The second, adds a USBCharge;
+ * The third, adds a waterBottle.
+ */
+class WithLaptopSlot : public BackpackDecorator
+{
+public:
+  WithLaptopSlot(IBackpack *dcrator) : BackpackDecorator(dcrator) {}
+  virtual void assemble()
+  {
+    BackpackDecorator::assemble();
+    std::cout << LaptopSlot::label;
+  }
+  virtual void assemble(BackpackSink &sink)
+  {
+    BackpackDecorator::assemble(sink);
+    sink.append(LaptopSlot::label);
+  }
+  virtual const char *label() const { return LaptopSlot::label; }
+};
+
+class WithUSBCharge : public BackpackDecorator
+{
+public:
+  WithUSBCharge(IBackpack *dcrator) : BackpackDecorator(dcrator) {}
+  virtual void assemble()
+  {
+    BackpackDecorator::assemble();
+    std::cout << USBCharge::label;
+  }
+  virtual void assemble(BackpackSink &sink)
+  {
+    BackpackDecorator::assemble(sink);
+    sink.append(USBCharge::label);
+  }
+  virtual const char *label() const { return USBCharge::label; }
+};
+
+class WithWaterBottle : public BackpackDecorator
+{
+public:
+  WithWaterBottle(IBackpack *dcrator) : BackpackDecorator(dcrator) {}
+  virtual void assemble()
+  {
+    BackpackDecorator::assemble();
+    std::cout << WaterBottle::label;
+  }
+  virtual void assemble(BackpackSink &sink)
+  {
+    BackpackDecorator::assemble(sink);
+    sink.append(WaterBottle::label);
+  }
+  virtual const char *label() const { return WaterBottle::label; }
+};
+
+#endif // BACKPACK_H
@@ -0,0 +1,118 @@
+#ifndef BACKPACK_ARENA_H
+#define BACKPACK_ARENA_H
+
+#include <cstddef>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include "Backpack.h"
+
+/**
+ * Arena for decorator chains.
+ *
+ * Building a chain with `new` for every layer scatters the nodes over
+ * the heap. BackpackArena takes one block up front and places every
+ * node of the chain in it, one after the other, so walking assemble()
+ * touches adjacent memory and the whole chain is freed at once.
+ *
+ * Each node is preceded by a small Slot that remembers where the
+ * previous node is, so the destructor can run the nodes' destructors
+ * from the outermost decorator inwards before releasing the block.
+ */
+class BackpackArena
+{
+public:
+  explicit BackpackArena(std::size_t bytes)
+      : m_Begin(static_cast<char *>(::operator new(bytes))),
+        m_Used(0), m_Capacity(bytes), m_Last(nullptr) {}
+
+  ~BackpackArena()
+  {
+    for (Slot *slot = m_Last; slot; slot = slot->prev)
+      slot->node->~IBackpack();
+    ::operator delete(m_Begin);
+  }
+
+  BackpackArena(const BackpackArena &) = delete;
+  BackpackArena &operator=(const BackpackArena &) = delete;
+
+  /**
+   * Construct a T in the arena. Returns nullptr if the arena is full;
+   * size it with bytesFor<>() to avoid that.
+   */
+  template <class T, class... Args>
+  T *create(Args &&...args)
+  {
+    static_assert(std::is_base_of<IBackpack, T>::value,
+                  "only IBackpack nodes live in a BackpackArena");
+
+    std::size_t need = slotSize<T>();
+    if (m_Used + need > m_Capacity)
+      return nullptr;
+
+    Slot *slot = new (m_Begin + m_Used) Slot;
+    T *node = new (m_Begin + m_Used + align(sizeof(Slot))) T(std::forward<Args>(args)...);
+    slot->node = node;
+    slot->prev = m_Last;
+    m_Last = slot;
+    m_Used += need;
+    return node;
+  }
+
+  // Bytes needed to hold one node of each of the given types.
+  template <class... Nodes>
+  static constexpr std::size_t bytesFor()
+  {
+    return (std::size_t(0) + ... + slotSize<Nodes>());
+  }
+
+private:
+  struct Slot
+  {
+    IBackpack *node;
+    Slot *prev;
+  };
+
+  static constexpr std::size_t align(std::size_t n)
+  {
+    return (n + alignof(std::max_align_t) - 1) & ~(alignof(std::max_align_t) - 1);
+  }
+
+  template <class T>
+  static constexpr std::size_t slotSize()
+  {
+    return align(sizeof(Slot)) + align(sizeof(T));
+  }
+
+  char *m_Begin;
+  std::size_t m_Used;
+  std::size_t m_Capacity;
+  Slot *m_Last;
+};
+
+/**
+ * Build Component wrapped by each of Decorators in turn, innermost
+ * first, in a single arena allocation:
+ *
+ *     ArenaChain<PlainBackpack, WithLaptopSlot, WithUSBCharge> chain;
+ *     chain->assemble();
+ */
+template <class Component, class... Decorators>
+class ArenaChain
+{
+public:
+  ArenaChain() : m_Arena(BackpackArena::bytesFor<Component, Decorators...>())
+  {
+    m_Top = m_Arena.create<Component>();
+    ((m_Top = m_Arena.create<Decorators>(m_Top)), ...);
+  }
+
+  IBackpack *get() const { return m_Top; }
+  IBackpack *operator->() const { return m_Top; }
+
+private:
+  BackpackArena m_Arena;
+  IBackpack *m_Top;
+};
+
+#endif // BACKPACK_ARENA_H
@@ -0,0 +1,145 @@
+#ifndef BACKPACK_BATCH_H
+#define BACKPACK_BATCH_H
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <initializer_list>
+#include <typeinfo>
+#include <vector>
+#include "Backpack.h"
+#include "BackpackWalk.h"
+
+/**
+ * Backpacks as data.
+ *
+ * The features form a small closed set, so a configuration does not
+ * need a chain of objects at all. A BackpackBatch stores each backpack
+ * in two bytes, in two parallel arrays:
+ *   - a bitmask of the features it has;
+ *   - the order they were added in, two bits per feature, innermost
+ *     in the low bits.
+ * Each feature appears at most once, so the number of features is the
+ * number of bits set in the mask.
+ *
+ * assemble() then runs over both arrays in one pass with no pointer
+ * chasing and no virtual calls.
+ */
+enum class Feature : std::uint8_t
+{
+  LaptopSlot,
+  USBCharge,
+  WaterBottle
+};
+
+class BackpackBatch
+{
+public:
+  static const std::size_t FeatureCount = 3;
+
+  void reserve(std::size_t n)
+  {
+    m_Masks.reserve(n);
+    m_Orders.reserve(n);
+  }
+
+  std::size_t size() const { return m_Masks.size(); }
+
+  /**
+   * Add a PlainBackpack with the given features, innermost first.
+   * Returns false, and adds nothing, if a feature is repeated.
+   */
+  bool add(std::initializer_list<Feature> features)
+  {
+    std::uint8_t mask = 0, order = 0, shift = 0;
+    for (Feature feature : features)
+    {
+      std::uint8_t bit = std::uint8_t(1u << unsigned(feature));
+      if (mask & bit)
+        return false;
+      mask |= bit;
+      order |= std::uint8_t(unsigned(feature) << shift);
+      shift += 2;
+    }
+    m_Masks.push_back(mask);
+    m_Orders.push_back(order);
+    return true;
+  }
+
+  /**
+   * Add the configuration of an existing chain. Returns false, and adds
+   * nothing, unless the chain is a PlainBackpack under the concrete
+   * decorators, each at most once.
+   */
+  bool add(IBackpack *chain)
+  {
+    BackpackWalk walk(chain);
+    if (typeid(*walk.component()) != typeid(PlainBackpack))
+      return false;
+
+    std::uint8_t mask = 0, order = 0, shift = 0;
+    bool ok = true;
+    walk.forEachLabel([&](const char *label) {
+      std::size_t feature = 0;
+      while (feature < FeatureCount && label != labelOf(feature))
+        ++feature;
+      std::uint8_t bit = std::uint8_t(1u << feature);
+      if (feature == FeatureCount || (mask & bit))
+      {
+        ok = false;
+        return;
+      }
+      mask |= bit;
+      order |= std::uint8_t(feature << shift);
+      shift += 2;
+    });
+    if (!ok)
+      return false;
+
+    m_Masks.push_back(mask);
+    m_Orders.push_back(order);
+    return true;
+  }
+
+  bool has(std::size_t i, Feature feature) const
+  {
+    return m_Masks[i] & (1u << unsigned(feature));
+  }
+
+  // Assemble every backpack in the batch, in order.
+  void assemble(BackpackSink &sink) const
+  {
+    const std::size_t baseLength = std::strlen(PlainBackpack::label);
+    std::size_t lengths[FeatureCount];
+    for (std::size_t f = 0; f < FeatureCount; ++f)
+      lengths[f] = std::strlen(labelOf(f));
+
+    const std::uint8_t *masks = m_Masks.data();
+    const std::uint8_t *orders = m_Orders.data();
+    for (std::size_t i = 0, n = m_Masks.size(); i < n; ++i)
+    {
+      sink.append(PlainBackpack::label, baseLength);
+      unsigned order = orders[i];
+      for (unsigned k = popcount(masks[i]); k > 0; --k, order >>= 2)
+        sink.append(labelOf(order & 3), lengths[order & 3]);
+    }
+  }
+
+private:
+  static const char *labelOf(std::size_t feature)
+  {
+    static const char *const labels[FeatureCount] = {
+        LaptopSlot::label, USBCharge::label, WaterBottle::label};
+    return labels[feature];
+  }
+
+  static unsigned popcount(std::uint8_t mask)
+  {
+    return (mask & 1) + ((mask >> 1) & 1) + ((mask >> 2) & 1);
+  }
+
+  std::vector<std::uint8_t> m_Masks;
+  std::vector<std::uint8_t> m_Orders;
+};
+
+#endif // BACKPACK_BATCH_H
@@ -0,0 +1,153 @@
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+#include "Backpack.h"
+#include "BackpackCache.h"
+#include "BackpackChain.h"
+#include "BackpackFixtures.h"
+#include "BackpackParallel.h"
+#include "BackpackTrace.h"
+#include "Benchmark.h"
+#include "VariantBackpack.h"
+using namespace std;
+
+/**
+ * Virtual chain vs. variant engine vs. cache.
+ *
+ *     BackpackBenchmark [--json results.json]
+ *
+ * Both backpacks get the same features in the same order and are
+ * assembled into a sink so that output cost does not drown the
+ * dispatch cost. Every case runs on BenchmarkSuite, which prints its
+ * row as it goes; the tables at the end compare the medians. With
+ * --json the suite's results are written out as well.
+ */
+static const int TraceIterations = 200000;
+
+static void depthCases(BenchmarkSuite &suite)
+{
+  struct Row
+  {
+    int depth;
+    double ns[3];
+  };
+  vector<Row> rows;
+
+  for (int depth = 1; depth <= 64; depth *= 2)
+  {
+    BackpackChain chain = virtualChain(depth);
+    VariantBackpack variant = variantBackpack(depth);
+    BackpackCache cache;
+    BackpackSink sink(64 + 16 * depth);
+    const string suffix = "/depth=" + to_string(depth);
+
+    Row row;
+    row.depth = depth;
+    row.ns[0] = suite.run("backpack/virtual" + suffix, [&] {
+      sink.clear();
+      chain->assemble(sink);
+    }).medianNs;
+    row.ns[1] = suite.run("backpack/variant" + suffix, [&] {
+      sink.clear();
+      variant.assemble(sink);
+    }).medianNs;
+    row.ns[2] = suite.run("backpack/cached" + suffix, [&] {
+      sink.clear();
+      cache.assemble(chain.get(), sink);
+    }).medianNs;
+    rows.push_back(row);
+  }
+
+  printf("\n%6s %14s %14s %14s\n", "depth", "virtual ns/op", "variant ns/op", "cached ns/op");
+  for (const Row &row : rows)
+    printf("%6d %14.1f %14.1f %14.1f\n", row.depth, row.ns[0], row.ns[1], row.ns[2]);
+}
+
+/**
+ * Bulk assembly on a work-stealing pool: the same list of chains on
+ * 1 to 64 threads, against the one-thread time. One operation is the
+ * whole list; each thread count keeps one BulkAssembler, so its worker
+ * buffers are warm after the first run, as they would be in a program
+ * that assembles repeatedly.
+ */
+static void bulkCases(BenchmarkSuite &suite)
+{
+  const size_t BulkChains = 50000;
+  vector<BackpackChain> owners;
+  vector<IBackpack *> chains;
+  for (size_t i = 0; i < BulkChains; ++i)
+  {
+    owners.push_back(virtualChain(1 + i % 16));
+    chains.push_back(owners.back().get());
+  }
+
+  vector<pair<size_t, double> > rows;
+  for (size_t threads = 1; threads <= 64; threads *= 2)
+  {
+    WorkStealingPool pool(threads);
+    BulkAssembler assembler(pool);
+    BackpackSink out;
+    double ns = suite.runThreaded("backpack/bulk/" + to_string(BulkChains) + "/threads=" + to_string(threads), [&] {
+      out.clear();
+      assembler.assemble(chains, out);
+    }).medianNs;
+    rows.push_back(make_pair(threads, ns / BulkChains));
+  }
+
+  printf("\n%7s %14s %8s\n", "threads", "ns/chain", "speedup");
+  for (const auto &row : rows)
+    printf("%7zu %14.1f %8.2f\n", row.first, row.second, rows.front().second / row.second);
+}
+
+/**
+ * Where the time goes inside one depth-8 chain, layer by layer.
+ */
+static void traceReport()
+{
+  printf("\n");
+  BackpackChain traced = virtualChain(8);
+  traced.reset(instrument(traced.release()));
+  BackpackSink sink;
+  for (int i = 0; i < TraceIterations; ++i)
+  {
+    sink.clear();
+    traced->assemble(sink);
+  }
+  BackpackTrace::report(cout);
+}
+
+int main(int argc, char *argv[])
+{
+  const char *jsonPath = nullptr;
+  for (int i = 1; i < argc; ++i)
+  {
+    if (strcmp(argv[i], "--json") == 0 && i + 1 < argc)
+      jsonPath = argv[++i];
+    else
+    {
+      cerr << "usage: " << argv[0] << " [--json results.json]\n";
+      return 2;
+    }
+  }
+
+  BenchmarkSuite suite("backpack");
+  if (!suite.hasCounters())
+    cerr << "hardware counters unavailable, reporting time only\n";
+  depthCases(suite);
+  bulkCases(suite);
+  traceReport();
+
+  if (jsonPath)
+  {
+    ofstream json(jsonPath);
+    suite.writeJson(json);
+    if (!json)
+    {
+      cerr << "could not write " << jsonPath << "\n";
+      return 1;
+    }
+  }
+  return 0;
+}
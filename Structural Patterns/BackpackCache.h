@@ -0,0 +1,187 @@
+#ifndef BACKPACK_CACHE_H
+#define BACKPACK_CACHE_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <string>
+#include <typeinfo>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include "Backpack.h"
+#include "BackpackWalk.h"
+
+/**
+ * Chain signatures.
+ *
+ * The description of a chain of PlainBackpack and the concrete
+ * decorators depends only on which decorators wrap it and in what
+ * order, not on the objects themselves. BackpackSignatures numbers
+ * each such sequence: PlainBackpack alone is Plain, and every decorator
+ * label on top of a signature gets a signature of its own, interned
+ * process-wide. Each decorator type is identified by the address of its
+ * label().
+ *
+ * of() memoizes the signature in every decorator it walks past, tagged
+ * with BackpackDecorator::shapeEpoch(). Asking again for the same chain
+ * is then one load at the top of the chain, however deep it is. The
+ * epoch is global: a setComponent() on any chain, including the ones
+ * instrument() and uninstrument() make, invalidates the memo in every
+ * decorator, so each chain is walked once more on its next of(). A
+ * program that relinks chains all the time walks them all the time.
+ *
+ * Signatures are interned for the life of the process, one per distinct
+ * sequence of labels ever seen, counting every prefix of every chain
+ * passed to of(). Chains built from a fixed set of configurations stop
+ * adding signatures once each has been seen; chains of ever new shapes
+ * grow the registry without bound.
+ *
+ * Forwarding BackpackDecorators add nothing to the description and so
+ * nothing to the signature. Chains containing anything else that a
+ * signature cannot describe (other components, decorators without a
+ * label()) are Uncacheable.
+ */
+class BackpackSignatures
+{
+public:
+  static const std::uint32_t Uncacheable = 0;
+  static const std::uint32_t Plain = 1;
+
+  static std::uint32_t of(IBackpack *chain)
+  {
+    BackpackDecorator *top = chain->asDecorator();
+    if (!top)
+      return leaf(chain);
+    std::uint32_t epoch = BackpackDecorator::shapeEpoch().load(std::memory_order_relaxed);
+    std::uint64_t memo = top->signature().load(std::memory_order_relaxed);
+    if (std::uint32_t(memo >> 32) == epoch)
+      return std::uint32_t(memo);
+    return walk(top, epoch);
+  }
+
+  // The signature of `label` added on top of `inner`.
+  static std::uint32_t extend(std::uint32_t inner, const char *label)
+  {
+    if (inner == Uncacheable)
+      return Uncacheable;
+    Registry &registry = getRegistry();
+    std::lock_guard<std::mutex> lock(registry.mutex);
+    auto found = registry.ids.emplace(std::make_pair(inner, label), registry.next);
+    if (found.second)
+      ++registry.next;
+    return found.first->second;
+  }
+
+private:
+  struct Registry
+  {
+    std::mutex mutex;
+    std::map<std::pair<std::uint32_t, const char *>, std::uint32_t> ids;
+    std::uint32_t next = Plain + 1;
+  };
+
+  static Registry &getRegistry()
+  {
+    static Registry registry;
+    return registry;
+  }
+
+  static std::uint32_t leaf(IBackpack *node)
+  {
+    return typeid(*node) == typeid(PlainBackpack) ? Plain : Uncacheable;
+  }
+
+  // Walk down to a memoized decorator or the component, then memoize
+  // every decorator on the way back up.
+  static std::uint32_t walk(BackpackDecorator *top, std::uint32_t epoch)
+  {
+    std::vector<BackpackDecorator *> path;
+    std::uint32_t id = Uncacheable;
+    IBackpack *node = top;
+    for (;;)
+    {
+      BackpackDecorator *decorator = node->asDecorator();
+      if (!decorator)
+      {
+        id = leaf(node);
+        break;
+      }
+      std::uint64_t memo = decorator->signature().load(std::memory_order_relaxed);
+      if (std::uint32_t(memo >> 32) == epoch)
+      {
+        id = std::uint32_t(memo);
+        break;
+      }
+      path.push_back(decorator);
+      node = decorator->component();
+    }
+
+    for (std::size_t i = path.size(); i-- > 0;)
+    {
+      BackpackDecorator *decorator = path[i];
+      if (const char *label = decorator->label())
+        id = extend(id, label);
+      else if (typeid(*decorator) != typeid(BackpackDecorator))
+        id = Uncacheable;
+      decorator->signature().store((std::uint64_t(epoch) << 32) | id, std::memory_order_relaxed);
+    }
+    return id;
+  }
+};
+
+/**
+ * Memoized assembly.
+ *
+ * BackpackCache keeps one description per chain signature (see
+ * BackpackSignatures) it has been asked about, in a hash map keyed by
+ * the signature, so a cache's size follows the chains it sees rather
+ * than every signature in the process. Once a chain's signature is
+ * memoized, describe() is a load and a lookup; the chain is assembled
+ * and formatted only on the first miss. Uncacheable chains are
+ * assembled every time.
+ *
+ * A BackpackCache is not thread-safe, but several caches on several
+ * threads may share chains.
+ */
+class BackpackCache
+{
+public:
+  /**
+   * The description of chain. The reference stays valid for the life of
+   * the cache, except for uncached chains, whose description is only
+   * valid until the next call.
+   */
+  const std::string &describe(IBackpack *chain)
+  {
+    std::uint32_t id = BackpackSignatures::of(chain);
+    auto found = m_ById.find(id);
+    if (found != m_ById.end())
+      return found->second;
+
+    BackpackSink sink;
+    assembleIteratively(chain, sink);
+    if (id == BackpackSignatures::Uncacheable)
+    {
+      m_Uncached = sink.str();
+      return m_Uncached;
+    }
+    return m_ById.emplace(id, sink.str()).first->second;
+  }
+
+  void assemble(IBackpack *chain) { std::cout << describe(chain); }
+  void assemble(IBackpack *chain, BackpackSink &sink) { sink.append(describe(chain)); }
+
+  // Number of distinct signatures cached.
+  std::size_t size() const { return m_ById.size(); }
+  void clear() { m_ById.clear(); }
+
+private:
+  // Node-based, so a description stays put as others are added.
+  std::unordered_map<std::uint32_t, std::string> m_ById;
+  std::string m_Uncached;
+};
+
+#endif // BACKPACK_CACHE_H
@@ -0,0 +1,70 @@
+#include <cstdio>
+#include <string>
+#include "Backpack.h"
+#include "BackpackCache.h"
+#include "BackpackChain.h"
+#include "BackpackFixtures.h"
+#include "BackpackTrace.h"
+#include "Check.h"
+using namespace std;
+
+/**
+ * Checks that BackpackCache never serves a description a chain no
+ * longer assembles: after the chain is relinked with setComponent() or
+ * copy-assigned, and after it is instrumented and uninstrumented. Every
+ * describe() is compared with assembling the chain directly. Exits
+ * non-zero otherwise.
+ */
+
+static string assembled(IBackpack *chain)
+{
+  BackpackSink sink;
+  chain->assemble(sink);
+  return sink.str();
+}
+
+static bool matches(BackpackCache &cache, IBackpack *chain)
+{
+  return cache.describe(chain) == assembled(chain);
+}
+
+int main()
+{
+  BackpackCache cache;
+  BackpackChain chain = virtualChain(3);
+  check(matches(cache, chain.get()), "a fresh chain is described as it assembles");
+  check(matches(cache, chain.get()), "a memoized chain is described as it assembles");
+
+  // Relink the top decorator onto a deeper chain, and back.
+  BackpackDecorator *top = chain->asDecorator();
+  IBackpack *below = top->component();
+  BackpackChain deeper = virtualChain(5);
+  top->setComponent(deeper.get());
+  check(matches(cache, chain.get()), "a relinked chain is walked again");
+  top->setComponent(below);
+  check(matches(cache, chain.get()), "a chain relinked back is described as before");
+
+  // Copy-assigning a decorator relinks it too.
+  PlainBackpack plain;
+  WithLaptopSlot outer(deeper.get()), inner(&plain);
+  check(matches(cache, &outer), "a stack decorator is described as it assembles");
+  outer = inner;
+  check(matches(cache, &outer), "a copy-assigned decorator is walked again");
+
+  // Tracers make a chain uncacheable; taking them out makes it cacheable again.
+  const size_t cached = cache.size();
+  chain.reset(instrument(chain.release()));
+  check(matches(cache, chain.get()), "an instrumented chain is described as it assembles");
+  check(cache.size() == cached, "an instrumented chain adds no cached description");
+  chain.reset(uninstrument(chain.release()));
+  check(matches(cache, chain.get()), "an uninstrumented chain is described as before");
+  check(matches(cache, virtualChain(3).get()), "another chain of the same shape shares the description");
+
+  cache.clear();
+  check(cache.size() == 0 && matches(cache, chain.get()), "a cleared cache describes chains again");
+
+  if (failures)
+    return 1;
+  printf("BackpackCache: descriptions follow relinked and instrumented chains\n");
+  return 0;
+}
@@ -0,0 +1,264 @@
+#ifndef BACKPACK_CATALOG_H
+#define BACKPACK_CATALOG_H
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <typeinfo>
+#include <unordered_map>
+#include <vector>
+#include "Backpack.h"
+#include "BackpackChain.h"
+#ifdef __unix__
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+/**
+ * Catalog file format.
+ *
+ * A catalog stores chains as data: which component sits at the bottom
+ * and which decorators wrap it, innermost first. All integers are
+ * little-endian.
+ *
+ *     offset 0    "BKPK"
+ *            4    u32 version (1)
+ *            8    u64 count
+ *           16    u64 offset[count]   where each record starts
+ *                 records...
+ *
+ *     record      u8  component id
+ *                 u32 layer count
+ *                 u8  layer id[layer count]
+ *
+ * The offset table lets any chain be found without reading the ones
+ * before it.
+ */
+enum BackpackLayerId : std::uint8_t
+{
+  PlainBackpackId = 0,
+
+  BackpackDecoratorId = 0,
+  WithLaptopSlotId = 1,
+  WithUSBChargeId = 2,
+  WithWaterBottleId = 3
+};
+
+/**
+ * Write chains to a catalog file. Returns false if a chain contains a
+ * layer the format has no id for, or the file cannot be written.
+ */
+inline bool writeCatalog(const std::string &path, const std::vector<IBackpack *> &chains)
+{
+  std::vector<std::uint8_t> records;
+  std::vector<std::uint64_t> offsets;
+  std::vector<std::uint8_t> layers;
+  std::uint64_t tableEnd = 16 + 8 * std::uint64_t(chains.size());
+
+  for (IBackpack *chain : chains)
+  {
+    layers.clear();
+    IBackpack *node = chain;
+    while (BackpackDecorator *decorator = node->asDecorator())
+    {
+      const std::type_info &type = typeid(*decorator);
+      if (type == typeid(BackpackDecorator))
+        layers.push_back(BackpackDecoratorId);
+      else if (type == typeid(WithLaptopSlot))
+        layers.push_back(WithLaptopSlotId);
+      else if (type == typeid(WithUSBCharge))
+        layers.push_back(WithUSBChargeId);
+      else if (type == typeid(WithWaterBottle))
+        layers.push_back(WithWaterBottleId);
+      else
+        return false;
+      node = decorator->component();
+    }
+    if (typeid(*node) != typeid(PlainBackpack))
+      return false;
+
+    offsets.push_back(tableEnd + records.size());
+    records.push_back(PlainBackpackId);
+    for (int i = 0; i < 4; ++i)
+      records.push_back(std::uint8_t(layers.size() >> (8 * i)));
+    records.insert(records.end(), layers.rbegin(), layers.rend());
+  }
+
+  std::vector<std::uint8_t> header(16);
+  std::memcpy(header.data(), "BKPK", 4);
+  header[4] = 1;
+  for (int i = 0; i < 8; ++i)
+    header[8 + i] = std::uint8_t(std::uint64_t(chains.size()) >> (8 * i));
+  for (std::uint64_t offset : offsets)
+    for (int i = 0; i < 8; ++i)
+      header.push_back(std::uint8_t(offset >> (8 * i)));
+
+  std::FILE *file = std::fopen(path.c_str(), "wb");
+  if (!file)
+    return false;
+  bool ok = std::fwrite(header.data(), 1, header.size(), file) == header.size() &&
+            std::fwrite(records.data(), 1, records.size(), file) == records.size();
+  return std::fclose(file) == 0 && ok;
+}
+
+/**
+ * A catalog file opened for reading.
+ *
+ * open() maps the file into memory and only checks its header, so it
+ * takes the same time however many chains the catalog holds. A chain
+ * is built the first time get() asks for it and kept until the
+ * catalog is closed.
+ *
+ * A BackpackCatalog is not thread-safe.
+ */
+class BackpackCatalog
+{
+public:
+  BackpackCatalog() : m_Data(nullptr), m_Size(0), m_Count(0) {}
+  ~BackpackCatalog() { close(); }
+
+  BackpackCatalog(const BackpackCatalog &) = delete;
+  BackpackCatalog &operator=(const BackpackCatalog &) = delete;
+
+  // Returns false if the file cannot be read or is not a catalog.
+  bool open(const std::string &path)
+  {
+    close();
+    if (!map(path))
+      return false;
+    if (m_Size < 16 || std::memcmp(m_Data, "BKPK", 4) != 0 || read32(4) != 1)
+    {
+      close();
+      return false;
+    }
+    m_Count = read64(8);
+    if (m_Count > (m_Size - 16) / 8)
+    {
+      close();
+      return false;
+    }
+    return true;
+  }
+
+  void close()
+  {
+    m_Chains.clear();
+    unmap();
+    m_Data = nullptr;
+    m_Size = 0;
+    m_Count = 0;
+  }
+
+  std::size_t size() const { return std::size_t(m_Count); }
+
+  /**
+   * The i-th chain, built on first use. The catalog owns it. Returns
+   * nullptr if i is out of range or the record is malformed.
+   */
+  IBackpack *get(std::size_t i)
+  {
+    if (i >= m_Count)
+      return nullptr;
+    auto found = m_Chains.find(i);
+    if (found != m_Chains.end())
+      return found->second.get();
+
+    std::uint64_t at = read64(16 + 8 * std::uint64_t(i));
+    if (at > m_Size || m_Size - at < 5 || m_Data[at] != PlainBackpackId)
+      return nullptr;
+    std::uint64_t layers = read32(at + 1);
+    if (m_Size - at - 5 < layers)
+      return nullptr;
+
+    BackpackChain chain = BackpackChain::make<PlainBackpack>();
+    for (const std::uint8_t *id = m_Data + at + 5, *end = id + layers; id != end; ++id)
+    {
+      switch (*id)
+      {
+      case BackpackDecoratorId: chain.wrap<BackpackDecorator>(); break;
+      case WithLaptopSlotId: chain.wrap<WithLaptopSlot>(); break;
+      case WithUSBChargeId: chain.wrap<WithUSBCharge>(); break;
+      case WithWaterBottleId: chain.wrap<WithWaterBottle>(); break;
+      default: return nullptr;
+      }
+    }
+    return m_Chains.emplace(i, std::move(chain)).first->second.get();
+  }
+
+private:
+  std::uint32_t read32(std::uint64_t at) const
+  {
+    std::uint32_t value = 0;
+    for (int i = 3; i >= 0; --i)
+      value = (value << 8) | m_Data[at + i];
+    return value;
+  }
+
+  std::uint64_t read64(std::uint64_t at) const
+  {
+    std::uint64_t value = 0;
+    for (int i = 7; i >= 0; --i)
+      value = (value << 8) | m_Data[at + i];
+    return value;
+  }
+
+#ifdef __unix__
+  bool map(const std::string &path)
+  {
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0)
+      return false;
+    struct stat info;
+    if (::fstat(fd, &info) != 0 || info.st_size == 0)
+    {
+      ::close(fd);
+      return false;
+    }
+    void *data = ::mmap(nullptr, std::size_t(info.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if (data == MAP_FAILED)
+      return false;
+    m_Data = static_cast<const std::uint8_t *>(data);
+    m_Size = std::uint64_t(info.st_size);
+    return true;
+  }
+
+  void unmap()
+  {
+    if (m_Data)
+      ::munmap(const_cast<std::uint8_t *>(m_Data), std::size_t(m_Size));
+  }
+#else
+  // Without mmap the file is read whole, so open() is no longer
+  // independent of catalog size.
+  bool map(const std::string &path)
+  {
+    std::FILE *file = std::fopen(path.c_str(), "rb");
+    if (!file)
+      return false;
+    std::uint8_t buffer[4096];
+    std::size_t n;
+    while ((n = std::fread(buffer, 1, sizeof(buffer), file)) > 0)
+      m_Buffer.insert(m_Buffer.end(), buffer, buffer + n);
+    std::fclose(file);
+    m_Data = m_Buffer.data();
+    m_Size = m_Buffer.size();
+    return true;
+  }
+
+  void unmap() { m_Buffer.clear(); }
+
+  std::vector<std::uint8_t> m_Buffer;
+#endif
+
+  const std::uint8_t *m_Data;
+  std::uint64_t m_Size;
+  std::uint64_t m_Count;
+  std::unordered_map<std::size_t, BackpackChain> m_Chains;
+};
+
+#endif // BACKPACK_CATALOG_H
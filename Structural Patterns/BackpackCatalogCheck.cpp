@@ -0,0 +1,235 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+#include "Backpack.h"
+#include "BackpackCatalog.h"
+#include "BackpackChain.h"
+#include "Check.h"
+using namespace std;
+
+/**
+ * Checks BackpackCatalog.
+ *
+ *   - Chains written with writeCatalog come back from get() assembling
+ *     the same description, and chains the format cannot express are
+ *     refused by writeCatalog.
+ *   - A damaged file is refused by open(), or its damaged records by
+ *     get(), without reading past the end of the mapping.
+ *   - open() takes about as long on a catalog of a million chains as
+ *     on one of ten.
+ *
+ * Writes its catalogs to the working directory. Exits non-zero if a
+ * check fails.
+ */
+
+static BackpackChain buildChain(int depth)
+{
+  BackpackChain chain = BackpackChain::make<PlainBackpack>();
+  for (int i = 0; i < depth; ++i)
+  {
+    switch (i % 4)
+    {
+    case 0: chain.wrap<WithLaptopSlot>(); break;
+    case 1: chain.wrap<WithUSBCharge>(); break;
+    case 2: chain.wrap<BackpackDecorator>(); break;
+    case 3: chain.wrap<WithWaterBottle>(); break;
+    }
+  }
+  return chain;
+}
+
+static string describe(IBackpack *chain)
+{
+  BackpackSink sink;
+  chain->assemble(sink);
+  return sink.str();
+}
+
+static vector<uint8_t> readFile(const string &path)
+{
+  vector<uint8_t> bytes;
+  if (FILE *file = fopen(path.c_str(), "rb"))
+  {
+    uint8_t buffer[4096];
+    size_t n;
+    while ((n = fread(buffer, 1, sizeof(buffer), file)) > 0)
+      bytes.insert(bytes.end(), buffer, buffer + n);
+    fclose(file);
+  }
+  return bytes;
+}
+
+static void writeFile(const string &path, const vector<uint8_t> &bytes)
+{
+  FILE *file = fopen(path.c_str(), "wb");
+  if (!bytes.empty())
+    fwrite(bytes.data(), 1, bytes.size(), file);
+  fclose(file);
+}
+
+static void put64(vector<uint8_t> &bytes, size_t at, uint64_t value)
+{
+  for (int i = 0; i < 8; ++i)
+    bytes[at + i] = uint8_t(value >> (8 * i));
+}
+
+// A layer the catalog format has no id for.
+class WithRainCover : public BackpackDecorator
+{
+public:
+  using BackpackDecorator::BackpackDecorator;
+};
+
+static void checkRoundTrip(const string &path)
+{
+  vector<BackpackChain> chains;
+  vector<IBackpack *> tops;
+  for (int depth = 0; depth < 12; ++depth)
+  {
+    chains.push_back(buildChain(depth));
+    tops.push_back(chains.back().get());
+  }
+  check(writeCatalog(path, tops), "writeCatalog writes known layers");
+
+  BackpackCatalog catalog;
+  check(catalog.open(path), "open a written catalog");
+  check(catalog.size() == chains.size(), "catalog holds every chain");
+  // Backwards, so that no chain is found by reading the ones before it.
+  for (size_t i = chains.size(); i-- > 0;)
+  {
+    IBackpack *chain = catalog.get(i);
+    check(chain && describe(chain) == describe(tops[i]), "a chain reads back as written");
+  }
+  check(catalog.get(3) == catalog.get(3), "get builds a chain once");
+  check(catalog.get(chains.size()) == nullptr, "get out of range is nullptr");
+
+  PlainBackpack plain;
+  WithRainCover rainCover(&plain);
+  vector<IBackpack *> unknown = {&rainCover};
+  check(!writeCatalog(path + ".unknown", unknown), "writeCatalog refuses an unknown layer");
+  remove((path + ".unknown").c_str());
+}
+
+static void checkMalformed(const string &path)
+{
+  vector<IBackpack *> tops;
+  BackpackChain a = buildChain(3), b = buildChain(5);
+  tops.push_back(a.get());
+  tops.push_back(b.get());
+  writeCatalog(path, tops);
+  const vector<uint8_t> good = readFile(path);
+  const size_t firstRecord = 16 + 8 * 2;
+  const string damaged = path + ".damaged";
+
+  auto opens = [&](const vector<uint8_t> &bytes) {
+    writeFile(damaged, bytes);
+    BackpackCatalog catalog;
+    return catalog.open(damaged);
+  };
+  // Opens, and get(0) is refused while get(1) still reads.
+  auto firstRecordRefused = [&](const vector<uint8_t> &bytes) {
+    writeFile(damaged, bytes);
+    BackpackCatalog catalog;
+    return catalog.open(damaged) && !catalog.get(0) && catalog.get(1) &&
+           describe(catalog.get(1)) == describe(b.get());
+  };
+
+  BackpackCatalog missing;
+  check(!missing.open(path + ".missing"), "open refuses a missing file");
+  check(!opens({}), "open refuses an empty file");
+  check(!opens(vector<uint8_t>(good.begin(), good.begin() + 15)), "open refuses a short header");
+
+  vector<uint8_t> bytes = good;
+  bytes[0] = 'X';
+  check(!opens(bytes), "open refuses a bad magic");
+  bytes = good;
+  bytes[4] = 2;
+  check(!opens(bytes), "open refuses an unknown version");
+  bytes = good;
+  put64(bytes, 8, uint64_t(1) << 60);
+  check(!opens(bytes), "open refuses a count larger than the file");
+  check(!opens(vector<uint8_t>(good.begin(), good.begin() + 20)), "open refuses a truncated offset table");
+
+  bytes = good;
+  put64(bytes, 16, good.size() + 100);
+  check(firstRecordRefused(bytes), "get refuses an offset past the end");
+  bytes = good;
+  put64(bytes, 16, ~uint64_t(0));
+  check(firstRecordRefused(bytes), "get refuses an offset that wraps");
+  bytes = good;
+  bytes[firstRecord] = 7;
+  check(firstRecordRefused(bytes), "get refuses an unknown component");
+  bytes = good;
+  bytes[firstRecord + 5] = 9;
+  check(firstRecordRefused(bytes), "get refuses an unknown layer");
+  bytes = good;
+  put64(bytes, 16, good.size() - 2);
+  check(firstRecordRefused(bytes), "get refuses a record cut short");
+  bytes = good;
+  bytes[firstRecord + 4] = 0xff;
+  check(firstRecordRefused(bytes), "get refuses a layer count past the end");
+
+  // Drop the last record's final layer: the last chain is now truncated.
+  bytes = vector<uint8_t>(good.begin(), good.end() - 1);
+  writeFile(damaged, bytes);
+  BackpackCatalog truncated;
+  check(truncated.open(damaged) && truncated.get(0) && !truncated.get(1),
+        "a truncated file opens and refuses only the cut record");
+  remove(damaged.c_str());
+}
+
+// Best of several opens, in microseconds.
+static double openMicros(const string &path)
+{
+  double best = 1e30;
+  for (int run = 0; run < 50; ++run)
+  {
+    BackpackCatalog catalog;
+    auto start = chrono::steady_clock::now();
+    bool ok = catalog.open(path);
+    auto stop = chrono::steady_clock::now();
+    check(ok, "open a catalog to time it");
+    best = min(best, chrono::duration<double, micro>(stop - start).count());
+  }
+  return best;
+}
+
+static void checkOpenTime(const string &path)
+{
+  const size_t SmallCount = 10, LargeCount = 1000000;
+  BackpackChain chain = buildChain(8);
+  writeCatalog(path + ".small", vector<IBackpack *>(SmallCount, chain.get()));
+  writeCatalog(path + ".large", vector<IBackpack *>(LargeCount, chain.get()));
+
+  double small = openMicros(path + ".small");
+  double large = openMicros(path + ".large");
+  printf("open: %zu chains %.1f us, %zu chains %.1f us\n", SmallCount, small, LargeCount, large);
+  // Reading the large catalog whole would take milliseconds; allow
+  // generous noise on top of the small catalog's time.
+  check(large < 4 * small + 100, "open time does not grow with the catalog");
+
+  BackpackCatalog catalog;
+  catalog.open(path + ".large");
+  check(catalog.size() == LargeCount && describe(catalog.get(LargeCount - 1)) == describe(chain.get()),
+        "the last chain of a large catalog reads back");
+
+  remove((path + ".small").c_str());
+  remove((path + ".large").c_str());
+}
+
+int main()
+{
+  const string path = "BackpackCatalogCheck.bkpk";
+  checkRoundTrip(path);
+  checkMalformed(path);
+  checkOpenTime(path);
+  remove(path.c_str());
+
+  if (failures)
+    return 1;
+  printf("BackpackCatalog: round trip, damaged files and open time all check out\n");
+  return 0;
+}
@@ -0,0 +1,88 @@
+#ifndef BACKPACK_CHAIN_H
+#define BACKPACK_CHAIN_H
+
+#include <memory>
+#include <stdexcept>
+#include <utility>
+#include "Backpack.h"
+#include "BackpackWalk.h"
+
+/**
+ * Owning chain.
+ *
+ * Decorators only refer to their component, so whoever builds a chain
+ * with `new` has to free every layer by hand. BackpackChain owns every
+ * layer of its chain and frees them all, outermost first, when it is
+ * destroyed. Like unique_ptr it can be moved but not copied, so there
+ * is always exactly one owner.
+ *
+ *     BackpackChain chain = BackpackChain::make<PlainBackpack>();
+ *     chain.wrap<WithLaptopSlot>().wrap<WithUSBCharge>();
+ *     chain->assemble();
+ */
+class BackpackChain
+{
+public:
+  BackpackChain() : m_Top(nullptr) {}
+
+  // Takes ownership of top and of every layer beneath it.
+  explicit BackpackChain(IBackpack *top) : m_Top(top) {}
+  explicit BackpackChain(std::unique_ptr<IBackpack> top) : m_Top(top.release()) {}
+
+  BackpackChain(BackpackChain &&other) noexcept : m_Top(other.release()) {}
+
+  BackpackChain &operator=(BackpackChain &&other) noexcept
+  {
+    if (this != &other)
+      reset(other.release());
+    return *this;
+  }
+
+  BackpackChain(const BackpackChain &) = delete;
+  BackpackChain &operator=(const BackpackChain &) = delete;
+
+  ~BackpackChain() { destroyChain(m_Top); }
+
+  template <class Component, class... Args>
+  static BackpackChain make(Args &&...args)
+  {
+    return BackpackChain(new Component(std::forward<Args>(args)...));
+  }
+
+  /**
+   * Wrap the chain so far in a new Decorator, which becomes the top.
+   * Throws std::logic_error on an empty chain, since the decorator would
+   * have nothing to delegate to.
+   */
+  template <class Decorator>
+  BackpackChain &wrap()
+  {
+    if (!m_Top)
+      throw std::logic_error("BackpackChain::wrap on an empty chain");
+    m_Top = new Decorator(m_Top);
+    return *this;
+  }
+
+  IBackpack *get() const { return m_Top; }
+  IBackpack *operator->() const { return m_Top; }
+  explicit operator bool() const { return m_Top != nullptr; }
+
+  // Give up ownership of the chain without freeing it.
+  IBackpack *release()
+  {
+    IBackpack *top = m_Top;
+    m_Top = nullptr;
+    return top;
+  }
+
+  void reset(IBackpack *top = nullptr)
+  {
+    destroyChain(m_Top);
+    m_Top = top;
+  }
+
+private:
+  IBackpack *m_Top;
+};
+
+#endif // BACKPACK_CHAIN_H
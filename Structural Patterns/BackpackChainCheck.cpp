@@ -0,0 +1,107 @@
+#include <cstdio>
+#include <stdexcept>
+#include <vector>
+#include "Backpack.h"
+#include "BackpackChain.h"
+#include "BackpackFixtures.h"
+#include "BackpackFusion.h"
+#include "BackpackWalk.h"
+#define CHECK_COUNT_ALLOCATIONS
+#include "Check.h"
+using namespace std;
+
+/**
+ * Checks that BackpackChain frees every layer it owns.
+ *
+ * Every operator new and delete in this program goes through a counter
+ * of live allocations. Building and destroying N chains, in all the
+ * ways BackpackChain can be moved, reset and released, must bring the
+ * count back to where it started. Also checks that assembleIteratively
+ * says when a decorator with its own behaviour kept it from walking the
+ * whole chain, and that fuse() keeps the output of the chains it fuses
+ * and leaves alone the ones it cannot. Exits non-zero otherwise.
+ */
+
+// Appends its own text without a label(), so a walk stops at it.
+class WithNameTag : public BackpackDecorator
+{
+public:
+  WithNameTag(IBackpack *component) : BackpackDecorator(component) {}
+  virtual void assemble(BackpackSink &sink)
+  {
+    BackpackDecorator::assemble(sink);
+    sink.append(" + NameTag");
+  }
+};
+
+int main()
+{
+  const int N = 10000;
+  const long baseline = liveAllocations;
+
+  {
+    vector<BackpackChain> chains;
+    for (int i = 0; i < N; ++i)
+      chains.push_back(virtualChain(i % 8));
+    check(liveAllocations > baseline, "chains allocate");
+
+    // Move some, reset some, release and re-adopt some.
+    for (int i = 0; i + 1 < N; i += 3)
+      chains[i] = std::move(chains[i + 1]);
+    for (int i = 2; i < N; i += 5)
+      chains[i].reset(virtualChain(4).release());
+    for (int i = 4; i < N; i += 7)
+      chains[i] = BackpackChain(chains[i].release());
+  }
+  check(liveAllocations == baseline, "N chains return the heap to baseline");
+
+  // Destroying a very deep chain must not recurse once per layer.
+  virtualChain(1000000);
+  check(liveAllocations == baseline, "a deep chain returns the heap to baseline");
+
+  {
+    BackpackChain deep = virtualChain(1000000);
+    BackpackSink sink;
+    check(assembleIteratively(deep.get(), sink), "a chain of labelled layers is walked to the bottom");
+
+    BackpackChain tagged = virtualChain(4);
+    tagged.wrap<WithNameTag>();
+    tagged.wrap<WithLaptopSlot>();
+    BackpackSink walked, recursed;
+    check(!assembleIteratively(tagged.get(), walked), "a decorator with its own behaviour ends the walk");
+    tagged->assemble(recursed);
+    check(walked.str() == recursed.str(), "a walk that stops early still assembles the whole chain");
+
+    IBackpack *fused = fuse(tagged.get());
+    BackpackSink fusedOut;
+    fused->assemble(fusedOut);
+    check(fused != tagged.get() && fusedOut.str() == recursed.str(), "a fused chain assembles the same text");
+    delete fused;
+
+    BackpackChain bare = BackpackChain::make<PlainBackpack>();
+    bare.wrap<BackpackDecorator>();
+    check(fuse(bare.get()) == bare.get(), "a chain with no labels is returned unfused");
+    bare.wrap<WithNameTag>();
+    bare.wrap<BackpackDecorator>();
+    check(fuse(bare.get()) == bare.get(), "a chain with no labels above its first custom decorator is returned unfused");
+  }
+  check(liveAllocations == baseline, "walked chains return the heap to baseline");
+
+  bool threw = false;
+  try
+  {
+    BackpackChain empty;
+    empty.wrap<WithLaptopSlot>();
+  }
+  catch (const logic_error &)
+  {
+    threw = true;
+  }
+  check(threw, "wrap on an empty chain throws");
+  check(liveAllocations == baseline, "a rejected wrap allocates nothing");
+
+  if (failures)
+    return 1;
+  printf("BackpackChain: %d chains built and freed, heap back to baseline\n", N);
+  return 0;
+}
@@ -0,0 +1,45 @@
+#ifndef BACKPACK_FIXTURES_H
+#define BACKPACK_FIXTURES_H
+
+#include "Backpack.h"
+#include "BackpackChain.h"
+#include "VariantBackpack.h"
+
+/**
+ * Backpacks of a given depth for the benchmarks and checks.
+ *
+ * Every one gets the same features in the same order, cycling through
+ * LaptopSlot, USBCharge and WaterBottle, so that the representations
+ * can be compared depth for depth.
+ */
+inline BackpackChain virtualChain(int depth)
+{
+  BackpackChain chain = BackpackChain::make<PlainBackpack>();
+  for (int i = 0; i < depth; ++i)
+  {
+    switch (i % 3)
+    {
+    case 0: chain.wrap<WithLaptopSlot>(); break;
+    case 1: chain.wrap<WithUSBCharge>(); break;
+    case 2: chain.wrap<WithWaterBottle>(); break;
+    }
+  }
+  return chain;
+}
+
+inline VariantBackpack variantBackpack(int depth)
+{
+  VariantBackpack backpack;
+  for (int i = 0; i < depth; ++i)
+  {
+    switch (i % 3)
+    {
+    case 0: backpack.add(LaptopSlot()); break;
+    case 1: backpack.add(USBCharge()); break;
+    case 2: backpack.add(WaterBottle()); break;
+    }
+  }
+  return backpack;
+}
+
+#endif // BACKPACK_FIXTURES_H
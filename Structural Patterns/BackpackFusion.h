@@ -0,0 +1,64 @@
+#ifndef BACKPACK_FUSION_H
+#define BACKPACK_FUSION_H
+
+#include <string>
+#include <utility>
+#include "Backpack.h"
+#include "BackpackWalk.h"
+
+/**
+ * Fused Decorator.
+ *
+ * A chain of N decorators costs N indirect calls on every assemble(),
+ * even though most layers only append a fixed piece of text. A
+ * FusedBackpack stands in for a whole run of such layers: it calls the
+ * component once and then writes the text of every layer it replaced.
+ */
+class FusedBackpack : public IBackpack
+{
+public:
+  FusedBackpack(IBackpack *component, std::string labels)
+      : m_Component(component), m_Labels(std::move(labels)) {}
+
+  virtual void assemble()
+  {
+    m_Component->assemble();
+    std::cout << m_Labels;
+  }
+  virtual void assemble(BackpackSink &sink)
+  {
+    m_Component->assemble(sink);
+    sink.append(m_Labels);
+  }
+
+private:
+  IBackpack *m_Component;
+  std::string m_Labels;
+};
+
+/**
+ * Fuse the chain starting at top.
+ *
+ * Walks the chain with BackpackWalk: bare BackpackDecorators are
+ * dropped, labelled decorators are merged into the fused node, and
+ * whatever ends the walk becomes the fused node's component. Only the
+ * run of layers above that node is fused. If it is a decorator with
+ * its own behaviour, an instrumented layer say, the labelled layers
+ * beneath it are left as they are.
+ *
+ * If the run holds no labelled layer there is nothing to fuse, and top
+ * itself is returned. Otherwise the result is a new node owned by the
+ * caller. It refers to the node that ended the walk, so the original
+ * chain must outlive it.
+ */
+inline IBackpack *fuse(IBackpack *top)
+{
+  BackpackWalk walk(top);
+  std::string labels;
+  walk.forEachLabel([&labels](const char *label) { labels += label; });
+  if (labels.empty())
+    return top;
+  return new FusedBackpack(walk.component(), labels);
+}
+
+#endif // BACKPACK_FUSION_H
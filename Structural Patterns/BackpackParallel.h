@@ -0,0 +1,260 @@
+#ifndef BACKPACK_PARALLEL_H
+#define BACKPACK_PARALLEL_H
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+#include "Backpack.h"
+
+/**
+ * Work-stealing pool.
+ *
+ * parallelFor() splits [0, chunks) into one contiguous run per worker
+ * and puts each run in that worker's queue. A worker takes chunks from
+ * the back of its own queue; once it is empty it steals from the front
+ * of the others', so a worker that drew cheap chunks helps out one
+ * that drew expensive ones.
+ *
+ * The calling thread is worker 0, so a pool of one thread starts no
+ * threads at all.
+ *
+ * If a task throws, no worker starts another chunk, and once every
+ * worker has stopped parallelFor() drops the chunks left over and
+ * rethrows the first exception to its caller.
+ */
+class WorkStealingPool
+{
+public:
+  typedef std::function<void(std::size_t worker, std::size_t chunk)> Task;
+
+  explicit WorkStealingPool(std::size_t threads)
+      : m_Task(nullptr), m_Generation(0), m_Busy(0), m_Stop(false), m_Failed(false)
+  {
+    if (threads == 0)
+      threads = 1;
+    for (std::size_t i = 0; i < threads; ++i)
+      m_Queues.emplace_back(new Queue);
+    for (std::size_t i = 1; i < threads; ++i)
+      m_Threads.emplace_back(&WorkStealingPool::threadMain, this, i);
+  }
+
+  ~WorkStealingPool()
+  {
+    {
+      std::lock_guard<std::mutex> lock(m_Mutex);
+      m_Stop = true;
+    }
+    m_Wake.notify_all();
+    for (std::thread &thread : m_Threads)
+      thread.join();
+  }
+
+  WorkStealingPool(const WorkStealingPool &) = delete;
+  WorkStealingPool &operator=(const WorkStealingPool &) = delete;
+
+  std::size_t size() const { return m_Queues.size(); }
+
+  // Run task for every chunk in [0, chunks) and wait for all of them.
+  void parallelFor(std::size_t chunks, const Task &task)
+  {
+    std::size_t workers = size();
+    for (std::size_t w = 0; w < workers; ++w)
+    {
+      Queue &queue = *m_Queues[w];
+      std::lock_guard<std::mutex> lock(queue.mutex);
+      for (std::size_t c = chunks * w / workers; c < chunks * (w + 1) / workers; ++c)
+        queue.chunks.push_back(c);
+    }
+
+    {
+      std::lock_guard<std::mutex> lock(m_Mutex);
+      m_Task = &task;
+      m_Busy = m_Threads.size();
+      ++m_Generation;
+    }
+    m_Wake.notify_all();
+
+    work(0, task);
+
+    std::unique_lock<std::mutex> lock(m_Mutex);
+    m_Done.wait(lock, [this] { return m_Busy == 0; });
+    m_Task = nullptr;
+    if (m_Error)
+    {
+      for (const std::unique_ptr<Queue> &queue : m_Queues)
+        queue->chunks.clear();
+      std::exception_ptr error = m_Error;
+      m_Error = nullptr;
+      m_Failed = false;
+      std::rethrow_exception(error);
+    }
+  }
+
+private:
+  struct Queue
+  {
+    std::mutex mutex;
+    std::deque<std::size_t> chunks;
+  };
+
+  void threadMain(std::size_t worker)
+  {
+    std::size_t seen = 0;
+    for (;;)
+    {
+      const Task *task;
+      {
+        std::unique_lock<std::mutex> lock(m_Mutex);
+        m_Wake.wait(lock, [&] { return m_Stop || m_Generation != seen; });
+        if (m_Stop)
+          return;
+        seen = m_Generation;
+        task = m_Task;
+      }
+
+      work(worker, *task);
+
+      std::lock_guard<std::mutex> lock(m_Mutex);
+      if (--m_Busy == 0)
+        m_Done.notify_one();
+    }
+  }
+
+  void work(std::size_t worker, const Task &task)
+  {
+    std::size_t chunk;
+    try
+    {
+      while (!m_Failed.load(std::memory_order_relaxed) && (pop(worker, chunk) || steal(worker, chunk)))
+        task(worker, chunk);
+    }
+    catch (...)
+    {
+      std::lock_guard<std::mutex> lock(m_Mutex);
+      if (!m_Error)
+        m_Error = std::current_exception();
+      m_Failed = true;
+    }
+  }
+
+  bool pop(std::size_t worker, std::size_t &chunk)
+  {
+    Queue &queue = *m_Queues[worker];
+    std::lock_guard<std::mutex> lock(queue.mutex);
+    if (queue.chunks.empty())
+      return false;
+    chunk = queue.chunks.back();
+    queue.chunks.pop_back();
+    return true;
+  }
+
+  bool steal(std::size_t thief, std::size_t &chunk)
+  {
+    for (std::size_t i = 1; i < m_Queues.size(); ++i)
+    {
+      Queue &queue = *m_Queues[(thief + i) % m_Queues.size()];
+      std::lock_guard<std::mutex> lock(queue.mutex);
+      if (!queue.chunks.empty())
+      {
+        chunk = queue.chunks.front();
+        queue.chunks.pop_front();
+        return true;
+      }
+    }
+    return false;
+  }
+
+  std::vector<std::unique_ptr<Queue>> m_Queues;
+  std::vector<std::thread> m_Threads;
+
+  std::mutex m_Mutex;
+  std::condition_variable m_Wake;
+  std::condition_variable m_Done;
+  const Task *m_Task;
+  std::size_t m_Generation;
+  std::size_t m_Busy;
+  bool m_Stop;
+  std::atomic<bool> m_Failed;
+  std::exception_ptr m_Error;
+};
+
+/**
+ * Bulk assembly on a pool.
+ *
+ * assemble() writes every chain into out, in order, on all of the
+ * pool's workers. The chains are cut into chunks of chunkSize. Each
+ * worker assembles the chunks it takes into its own buffer and notes
+ * where each one landed; once every chunk is done the pieces are copied
+ * into out in chunk order, so the result is the same as assembling
+ * sequentially.
+ *
+ * The buffers belong to the assembler and keep their capacity from one
+ * call to the next, so repeated calls on similar input allocate
+ * nothing. The chains are only read, so they may be shared between
+ * workers. If a chain throws, out is left as it was and the exception
+ * reaches the caller.
+ *
+ *     WorkStealingPool pool(8);
+ *     BulkAssembler assembler(pool);
+ *     assembler.assemble(chains, out);
+ */
+class BulkAssembler
+{
+public:
+  explicit BulkAssembler(WorkStealingPool &pool, std::size_t chunkSize = 256)
+      : m_Pool(pool), m_ChunkSize(chunkSize), m_Buffers(pool.size())
+  {
+    if (chunkSize == 0)
+      throw std::invalid_argument("BulkAssembler needs a chunk size of at least one");
+  }
+
+  void assemble(const std::vector<IBackpack *> &chains, BackpackSink &out)
+  {
+    std::size_t chunks = (chains.size() + m_ChunkSize - 1) / m_ChunkSize;
+    for (Buffer &buffer : m_Buffers)
+      buffer.sink.clear();
+    m_Pieces.resize(chunks);
+
+    m_Pool.parallelFor(chunks, [&](std::size_t worker, std::size_t chunk) {
+      BackpackSink &sink = m_Buffers[worker].sink;
+      std::size_t begin = sink.size();
+      std::size_t end = std::min(chains.size(), (chunk + 1) * m_ChunkSize);
+      for (std::size_t i = chunk * m_ChunkSize; i < end; ++i)
+        chains[i]->assemble(sink);
+      m_Pieces[chunk] = Piece{worker, begin, sink.size() - begin};
+    });
+
+    std::size_t total = out.size();
+    for (const Buffer &buffer : m_Buffers)
+      total += buffer.sink.size();
+    out.reserve(total);
+    for (const Piece &piece : m_Pieces)
+      out.append(m_Buffers[piece.worker].sink.str().data() + piece.offset, piece.length);
+  }
+
+private:
+  struct alignas(64) Buffer
+  {
+    BackpackSink sink;
+  };
+  struct Piece
+  {
+    std::size_t worker, offset, length;
+  };
+
+  WorkStealingPool &m_Pool;
+  std::size_t m_ChunkSize;
+  std::vector<Buffer> m_Buffers;
+  std::vector<Piece> m_Pieces;
+};
+
+#endif // BACKPACK_PARALLEL_H
@@ -0,0 +1,94 @@
+#include <cstdio>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include "Backpack.h"
+#include "BackpackChain.h"
+#include "BackpackFixtures.h"
+#include "BackpackParallel.h"
+#include "Check.h"
+using namespace std;
+
+/**
+ * Checks BulkAssembler and WorkStealingPool.
+ *
+ *   - Bulk assembly gives the sequential result on one to eight
+ *     threads, call after call on the same assembler.
+ *   - A chunk size of zero is refused.
+ *   - A chain that throws, on any worker, brings the exception back to
+ *     the caller with out untouched, and the pool keeps working.
+ *
+ * Exits non-zero if a check fails.
+ */
+
+// Throws from assemble(), on whichever worker draws it.
+class ThrowingBackpack : public IBackpack
+{
+public:
+  virtual void assemble() { throw runtime_error("torn strap"); }
+  virtual void assemble(BackpackSink &) { throw runtime_error("torn strap"); }
+};
+
+int main()
+{
+  const size_t Count = 5000;
+  vector<BackpackChain> owners;
+  vector<IBackpack *> chains;
+  BackpackSink sequential;
+  for (size_t i = 0; i < Count; ++i)
+  {
+    owners.push_back(virtualChain(int(i % 7)));
+    chains.push_back(owners.back().get());
+    chains.back()->assemble(sequential);
+  }
+
+  for (size_t threads = 1; threads <= 8; threads *= 2)
+  {
+    WorkStealingPool pool(threads);
+    BulkAssembler assembler(pool, 64);
+    for (int call = 0; call < 3; ++call)
+    {
+      BackpackSink out;
+      assembler.assemble(chains, out);
+      check(out.str() == sequential.str(), "bulk assembly matches sequential assembly");
+    }
+
+    bool refused = false;
+    try
+    {
+      BulkAssembler zero(pool, 0);
+    }
+    catch (const invalid_argument &)
+    {
+      refused = true;
+    }
+    check(refused, "a chunk size of zero is refused");
+
+    ThrowingBackpack broken;
+    vector<IBackpack *> withBroken = chains;
+    withBroken[Count / 2] = &broken;
+    withBroken[Count - 1] = &broken;
+    BackpackSink out;
+    out.append("kept");
+    bool threw = false;
+    try
+    {
+      assembler.assemble(withBroken, out);
+    }
+    catch (const runtime_error &)
+    {
+      threw = true;
+    }
+    check(threw, "a chain's exception reaches the caller");
+    check(out.str() == "kept", "a failed bulk assembly leaves out as it was");
+
+    out.clear();
+    assembler.assemble(chains, out);
+    check(out.str() == sequential.str(), "the pool works after a task threw");
+  }
+
+  if (failures)
+    return 1;
+  printf("BulkAssembler: %zu chains on 1 to 8 threads match sequential assembly\n", Count);
+  return 0;
+}
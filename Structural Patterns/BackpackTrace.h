@@ -0,0 +1,316 @@
+#ifndef BACKPACK_TRACE_H
+#define BACKPACK_TRACE_H
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <typeinfo>
+#include <vector>
+#include "Backpack.h"
+#ifdef __GNUG__
+#include <cxxabi.h>
+#endif
+
+/**
+ * Per-layer trace counters.
+ *
+ * Every traced layer type gets a slot. Each thread records into its own
+ * table of slots, so the hot path takes no lock: a thread only ever
+ * writes its own counters, with relaxed atomic stores that report()
+ * can read from another thread at any time. Tables are registered once
+ * per thread and outlive the thread, so nothing recorded is lost.
+ *
+ * Each slot keeps a call count, total time, and a histogram of call
+ * times in powers of two of nanoseconds. Times are exclusive: the time
+ * spent in the traced layers beneath a layer is not counted against it,
+ * and neither is what tracing those layers cost (see TracingDecorator).
+ */
+class BackpackTrace
+{
+public:
+  static const std::size_t MaxTypes = 64;
+  static const std::size_t Buckets = 32;
+  // A slot record() accepts like any other but report() never shows.
+  static const std::size_t Scratch = MaxTypes;
+
+  // The slot for layers of the given type, allocating one if needed.
+  static std::size_t slotFor(const std::type_info &type)
+  {
+    Registry &registry = instance();
+    std::lock_guard<std::mutex> lock(registry.mutex);
+    std::string name = demangle(type.name());
+    for (std::size_t i = 0; i < registry.names.size(); ++i)
+      if (registry.names[i] == name)
+        return i;
+    if (registry.names.size() == MaxTypes - 1)
+      registry.names.push_back("(other types)");
+    if (registry.names.size() == MaxTypes)
+      return MaxTypes - 1;
+    registry.names.push_back(name);
+    return registry.names.size() - 1;
+  }
+
+  static void record(std::size_t slot, std::uint64_t ns)
+  {
+    Slot &s = local().slots[slot];
+    std::size_t bucket = 0;
+    while (bucket + 1 < Buckets && (ns >> (bucket + 1)) != 0)
+      ++bucket;
+    bump(s.calls, 1);
+    bump(s.ns, ns);
+    bump(s.histogram[bucket], 1);
+  }
+
+  // Print calls, mean time and histogram for every traced layer type.
+  static void report(std::ostream &os)
+  {
+    Registry &registry = instance();
+    std::lock_guard<std::mutex> lock(registry.mutex);
+    for (std::size_t i = 0; i < registry.names.size(); ++i)
+    {
+      std::uint64_t calls = 0, ns = 0, histogram[Buckets] = {};
+      for (const std::unique_ptr<Table> &table : registry.tables)
+      {
+        const Slot &s = table->slots[i];
+        calls += s.calls.load(std::memory_order_relaxed);
+        ns += s.ns.load(std::memory_order_relaxed);
+        for (std::size_t b = 0; b < Buckets; ++b)
+          histogram[b] += s.histogram[b].load(std::memory_order_relaxed);
+      }
+      if (calls == 0)
+        continue;
+
+      char line[128];
+      std::snprintf(line, sizeof(line), "%-24s %12llu calls %10.1f ns/call\n",
+                    registry.names[i].c_str(), (unsigned long long)calls, double(ns) / calls);
+      os << line;
+      for (std::size_t b = 0; b < Buckets; ++b)
+      {
+        if (histogram[b] == 0)
+          continue;
+        std::snprintf(line, sizeof(line), "    < %10llu ns %12llu\n",
+                      (unsigned long long)(std::uint64_t(2) << b), (unsigned long long)histogram[b]);
+        os << line;
+      }
+    }
+  }
+
+  // Zero every counter. Only call while nothing is being traced.
+  static void reset()
+  {
+    Registry &registry = instance();
+    std::lock_guard<std::mutex> lock(registry.mutex);
+    for (const std::unique_ptr<Table> &table : registry.tables)
+    {
+      for (Slot &s : table->slots)
+      {
+        s.calls.store(0, std::memory_order_relaxed);
+        s.ns.store(0, std::memory_order_relaxed);
+        for (std::atomic<std::uint64_t> &count : s.histogram)
+          count.store(0, std::memory_order_relaxed);
+      }
+    }
+  }
+
+private:
+  struct Slot
+  {
+    std::atomic<std::uint64_t> calls;
+    std::atomic<std::uint64_t> ns;
+    std::atomic<std::uint64_t> histogram[Buckets];
+  };
+
+  struct Table
+  {
+    Slot slots[MaxTypes + 1] = {};
+  };
+
+  struct Registry
+  {
+    std::mutex mutex;
+    std::vector<std::string> names;
+    std::vector<std::unique_ptr<Table>> tables;
+  };
+
+  static Registry &instance()
+  {
+    static Registry registry;
+    return registry;
+  }
+
+  static Table &local()
+  {
+    thread_local Table *table = nullptr;
+    if (!table)
+    {
+      Registry &registry = instance();
+      std::lock_guard<std::mutex> lock(registry.mutex);
+      registry.tables.emplace_back(new Table);
+      table = registry.tables.back().get();
+    }
+    return *table;
+  }
+
+  // Only the owning thread writes a counter, so no read-modify-write.
+  static void bump(std::atomic<std::uint64_t> &counter, std::uint64_t by)
+  {
+    counter.store(counter.load(std::memory_order_relaxed) + by, std::memory_order_relaxed);
+  }
+
+  static std::string demangle(const char *name)
+  {
+#ifdef __GNUG__
+    int status = 0;
+    char *demangled = abi::__cxa_demangle(name, nullptr, nullptr, &status);
+    if (status == 0 && demangled)
+    {
+      std::string result(demangled);
+      std::free(demangled);
+      return result;
+    }
+#endif
+    return name;
+  }
+};
+
+/**
+ * Tracing Decorator.
+ *
+ * Forwards to its component like a bare BackpackDecorator, timing the
+ * call and recording it against the component's type. It reports no
+ * label(), so chain walks stop at it and run it as usual.
+ *
+ * Reading the clock is not free, and tracing a call costs time both
+ * inside the interval it measures and outside it, in the traced layer
+ * above. Both parts are measured once per process on empty calls: every
+ * recorded time has the inside part taken off, and a parent takes off
+ * the outside part for every traced call beneath it, along with the
+ * time those calls took.
+ */
+class TracingDecorator : public BackpackDecorator
+{
+public:
+  TracingDecorator(IBackpack *component)
+      : BackpackDecorator(component), m_Slot(BackpackTrace::slotFor(typeid(*component))) {}
+
+  virtual void assemble()
+  {
+    traced([this] { BackpackDecorator::assemble(); });
+  }
+  virtual void assemble(BackpackSink &sink)
+  {
+    traced([this, &sink] { BackpackDecorator::assemble(sink); });
+  }
+
+private:
+  template <class F>
+  void traced(F call)
+  {
+    static thread_local std::uint64_t childNs = 0;
+
+    const Overhead &cost = overhead();
+    std::uint64_t outerChildNs = childNs;
+    childNs = 0;
+    std::uint64_t ns = timed(m_Slot, call, childNs, cost.inside);
+    childNs = outerChildNs + ns + cost.outside;
+  }
+
+  // What tracing one call costs, in nanoseconds, within the time it
+  // measures and beyond.
+  struct Overhead
+  {
+    std::uint64_t inside, outside;
+  };
+
+  // Time call, record it less the time its children took (as call
+  // leaves it in childNs) and less inside, and return the time taken.
+  template <class F>
+  static std::uint64_t timed(std::size_t slot, F call, const std::uint64_t &childNs, std::uint64_t inside)
+  {
+    auto start = std::chrono::steady_clock::now();
+    call();
+    std::uint64_t ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                           std::chrono::steady_clock::now() - start).count();
+    std::uint64_t less = childNs + inside;
+    BackpackTrace::record(slot, ns > less ? ns - less : 0);
+    return ns;
+  }
+
+  static const Overhead &overhead()
+  {
+    static const Overhead overhead = calibrate();
+    return overhead;
+  }
+
+  // The least, over a few rounds, of what an empty traced call measures
+  // and of what it costs its caller beyond that.
+  static Overhead calibrate()
+  {
+    const int Calls = 1000;
+    Overhead best = {~std::uint64_t(0), ~std::uint64_t(0)};
+    const std::uint64_t none = 0;
+    for (int round = 0; round < 5; ++round)
+    {
+      std::uint64_t measured = 0;
+      auto start = std::chrono::steady_clock::now();
+      for (int i = 0; i < Calls; ++i)
+        measured += timed(BackpackTrace::Scratch, [] {}, none, 0);
+      std::uint64_t total = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                                std::chrono::steady_clock::now() - start).count();
+      std::uint64_t outside = total > measured ? (total - measured) / Calls : 0;
+      best.inside = std::min(best.inside, measured / Calls);
+      best.outside = std::min(best.outside, outside);
+    }
+    return best;
+  }
+
+  std::size_t m_Slot;
+};
+
+/**
+ * Put a TracingDecorator around every layer of the chain at top and
+ * return the new top. The tracers become part of the chain, so
+ * destroyChain() frees them along with the layers.
+ */
+inline IBackpack *instrument(IBackpack *top)
+{
+  for (BackpackDecorator *decorator = top->asDecorator(); decorator;)
+  {
+    IBackpack *component = decorator->component();
+    decorator->setComponent(new TracingDecorator(component));
+    decorator = component->asDecorator();
+  }
+  return new TracingDecorator(top);
+}
+
+// Take out and free every TracingDecorator; returns the new top.
+inline IBackpack *uninstrument(IBackpack *top)
+{
+  while (TracingDecorator *tracer = dynamic_cast<TracingDecorator *>(top))
+  {
+    top = tracer->component();
+    delete tracer;
+  }
+  for (BackpackDecorator *decorator = top->asDecorator(); decorator;)
+  {
+    IBackpack *component = decorator->component();
+    while (TracingDecorator *tracer = dynamic_cast<TracingDecorator *>(component))
+    {
+      component = tracer->component();
+      delete tracer;
+    }
+    decorator->setComponent(component);
+    decorator = component->asDecorator();
+  }
+  return top;
+}
+
+#endif // BACKPACK_TRACE_H
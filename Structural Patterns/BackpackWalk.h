@@ -0,0 +1,121 @@
+#ifndef BACKPACK_WALK_H
+#define BACKPACK_WALK_H
+
+#include <cstddef>
+#include <typeinfo>
+#include <vector>
+#include "Backpack.h"
+
+/**
+ * Iterative chain walk.
+ *
+ * BackpackDecorator::assemble() recurses through its component, so a
+ * chain built from a long configuration uses one stack frame per layer
+ * and eventually overflows the stack. BackpackWalk follows the chain
+ * with a loop instead and records what each layer adds:
+ *   - a bare BackpackDecorator only forwards, so it is skipped;
+ *   - a decorator with a label() contributes its label;
+ *   - anything else (a component, or a decorator with its own
+ *     behaviour) ends the walk and is called as usual.
+ *
+ * Only the layers above where the walk ends are walked in a loop. A
+ * decorator with its own behaviour, such as an instrumented layer,
+ * assembles whatever is below it recursively again, so a deep run of
+ * layers under one still overflows the stack; complete() says whether
+ * the walk reached the bottom of the chain.
+ *
+ * The first labels are kept in an inline array, so shallow chains are
+ * walked without allocating.
+ */
+class BackpackWalk
+{
+public:
+  explicit BackpackWalk(IBackpack *top) : m_Count(0)
+  {
+    IBackpack *node = top;
+    while (BackpackDecorator *decorator = node->asDecorator())
+    {
+      if (const char *label = decorator->label())
+        push(label);
+      else if (typeid(*decorator) != typeid(BackpackDecorator))
+        break;
+      node = decorator->component();
+    }
+    m_Component = node;
+  }
+
+  // The node that ended the walk.
+  IBackpack *component() const { return m_Component; }
+
+  // Whether the walk ended at the innermost component, not a decorator.
+  bool complete() const { return !m_Component->asDecorator(); }
+
+  // Calls f with every label, innermost layer first.
+  template <class F>
+  void forEachLabel(F f) const
+  {
+    for (std::size_t i = m_Count; i-- > 0;)
+      f(i < InlineLabels ? m_Inline[i] : m_Spill[i - InlineLabels]);
+  }
+
+private:
+  static const std::size_t InlineLabels = 16;
+
+  void push(const char *label)
+  {
+    if (m_Count < InlineLabels)
+      m_Inline[m_Count] = label;
+    else
+      m_Spill.push_back(label);
+    ++m_Count;
+  }
+
+  IBackpack *m_Component;
+  const char *m_Inline[InlineLabels];
+  std::vector<const char *> m_Spill;
+  std::size_t m_Count;
+};
+
+/**
+ * assemble() without one stack frame per labelled or bare layer.
+ *
+ * Returns whether the whole chain was walked that way. False means the
+ * walk stopped at a decorator with its own behaviour, whose assemble()
+ * recursed through the layers below it; the output is the same either
+ * way, but the stack was only bounded above that decorator.
+ */
+inline bool assembleIteratively(IBackpack *top)
+{
+  BackpackWalk walk(top);
+  walk.component()->assemble();
+  walk.forEachLabel([](const char *label) { std::cout << label; });
+  return walk.complete();
+}
+
+inline bool assembleIteratively(IBackpack *top, BackpackSink &sink)
+{
+  BackpackWalk walk(top);
+  walk.component()->assemble(sink);
+  walk.forEachLabel([&sink](const char *label) { sink.append(label); });
+  return walk.complete();
+}
+
+/**
+ * Delete every layer of a chain built with `new`, outermost first.
+ *
+ * Decorators do not own their component, so `delete top` only frees
+ * the outermost layer. This frees them all with a loop rather than
+ * recursion.
+ */
+inline void destroyChain(IBackpack *top)
+{
+  while (top)
+  {
+    BackpackDecorator *decorator = top->asDecorator();
+    IBackpack *next = decorator ? decorator->component() : nullptr;
+    delete top;
+    top = next;
+  }
+}
+
+#endif // BACKPACK_WALK_H
@@ -0,0 +1,215 @@
+#ifndef BENCHMARK_H
+#define BENCHMARK_H
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cstdio>
+#include <ostream>
+#include <string>
+#include <utility>
+#include <vector>
+#include "PerfCounters.h"
+
+/**
+ * Keep the compiler from optimizing away a value a benchmark computes.
+ */
+template <class T>
+inline void doNotOptimize(const T &value)
+{
+#if defined(__GNUC__) || defined(__clang__)
+    asm volatile("" : : "r,m"(value) : "memory");
+#else
+    const volatile T *sink = &value;
+    (void)sink;
+#endif
+}
+
+struct BenchmarkResult
+{
+    std::string name;
+    std::size_t opsPerSample;
+    std::size_t samples;
+    double minNs;
+    double medianNs;
+    double p99Ns;
+
+    // Hardware events per operation over the timed samples; -1 where
+    // the counter is unavailable.
+    double perOp[PerfCounters::EventCount];
+};
+
+/**
+ * A minimal benchmark harness.
+ *
+ * run() calls op once, then calibrates how many operations make up one
+ * sample (enough for the sample to take at least MinSampleNs), runs a
+ * few untimed warmup samples, then times Samples samples. Each result reports
+ * nanoseconds per operation: the fastest sample, the median and the
+ * 99th percentile. Where PerfCounters can be opened, each result also
+ * reports hardware events per operation, counted over the timed samples
+ * on the calling thread. An operation that spreads over several threads
+ * goes through runThreaded() instead, which reports time only.
+ *
+ *     BenchmarkSuite suite("structural");
+ *     suite.run("decorator/depth=4", [&] { chain->assemble(sink); });
+ *     suite.writeJson(std::cout);
+ */
+class BenchmarkSuite
+{
+public:
+    static const std::size_t Samples = 101;
+    static const std::size_t WarmupSamples = 5;
+    static constexpr double MinSampleNs = 200000;
+
+    explicit BenchmarkSuite(std::string name) : _name(std::move(name)) {}
+
+    // Benchmark op, which performs one operation per call.
+    template <class F>
+    const BenchmarkResult &run(const std::string &name, F op)
+    {
+        return run(name, op, [] {});
+    }
+
+    /**
+     * Benchmark op, calling beforeSample before every sample, outside
+     * the timing and the counters: to evict the caches for a cold run,
+     * say. Such a case usually wants op to be one long pass, so that a
+     * sample is a single operation.
+     */
+    template <class F, class S>
+    const BenchmarkResult &run(const std::string &name, F op, S beforeSample)
+    {
+        return measure(name, op, beforeSample, true);
+    }
+
+    /**
+     * Benchmark op, which hands its work to other threads. The counters
+     * would only see the calling thread, so its result has none.
+     */
+    template <class F>
+    const BenchmarkResult &runThreaded(const std::string &name, F op)
+    {
+        return measure(name, op, [] {}, false);
+    }
+
+    const std::vector<BenchmarkResult> &results() const { return _results; }
+    bool hasCounters() const { return _counters.available(); }
+
+    void writeJson(std::ostream &os) const
+    {
+        os << "{\n  \"suite\": \"" << _name << "\",\n  \"results\": [";
+        for (std::size_t i = 0; i < _results.size(); ++i)
+        {
+            const BenchmarkResult &r = _results[i];
+            char line[512];
+            std::snprintf(line, sizeof(line),
+                          "%s\n    {\"name\": \"%s\", \"ops_per_sample\": %zu, \"samples\": %zu, "
+                          "\"min_ns\": %.3f, \"median_ns\": %.3f, \"p99_ns\": %.3f",
+                          i ? "," : "", r.name.c_str(), r.opsPerSample, r.samples,
+                          r.minNs, r.medianNs, r.p99Ns);
+            os << line;
+            for (int e = 0; e < PerfCounters::EventCount; ++e)
+            {
+                if (r.perOp[e] < 0)
+                    continue;
+                std::snprintf(line, sizeof(line), ", \"%s_per_op\": %.3f",
+                              PerfCounters::name(PerfCounters::Event(e)), r.perOp[e]);
+                os << line;
+            }
+            os << "}";
+        }
+        os << "\n  ]\n}\n";
+    }
+
+private:
+    // run() and runThreaded(); count says whether to read the counters.
+    template <class F, class S>
+    const BenchmarkResult &measure(const std::string &name, F &op, S beforeSample, bool count)
+    {
+        // One untimed call first, so that one-off setup (a pool's first
+        // chunk, a lazily built table) does not pass for a slow operation.
+        beforeSample();
+        op();
+        std::size_t ops = 1;
+        for (;;)
+        {
+            beforeSample();
+            if (timeNs(op, ops) >= MinSampleNs || ops >= (std::size_t(1) << 30))
+                break;
+            ops *= 2;
+        }
+
+        for (std::size_t i = 0; i < WarmupSamples; ++i)
+        {
+            beforeSample();
+            timeNs(op, ops);
+        }
+
+        std::vector<double> nsPerOp(Samples);
+        double counts[PerfCounters::EventCount] = {};
+        for (double &ns : nsPerOp)
+        {
+            beforeSample();
+            if (!count)
+            {
+                ns = timeNs(op, ops) / ops;
+                continue;
+            }
+            _counters.start();
+            ns = timeNs(op, ops) / ops;
+            _counters.stop();
+            for (int e = 0; e < PerfCounters::EventCount; ++e)
+            {
+                double n = _counters.count(PerfCounters::Event(e));
+                counts[e] = n < 0 || counts[e] < 0 ? -1 : counts[e] + n;
+            }
+        }
+        if (!count)
+            std::fill(counts, counts + PerfCounters::EventCount, -1.0);
+        std::sort(nsPerOp.begin(), nsPerOp.end());
+
+        BenchmarkResult result;
+        result.name = name;
+        result.opsPerSample = ops;
+        result.samples = Samples;
+        result.minNs = nsPerOp.front();
+        result.medianNs = nsPerOp[Samples / 2];
+        result.p99Ns = nsPerOp[(Samples * 99) / 100];
+        for (int e = 0; e < PerfCounters::EventCount; ++e)
+            result.perOp[e] = counts[e] < 0 ? -1 : counts[e] / (double(ops) * Samples);
+        _results.push_back(result);
+
+        printRow(result);
+        return _results.back();
+    }
+
+    template <class F>
+    static double timeNs(F &op, std::size_t ops)
+    {
+        auto start = std::chrono::steady_clock::now();
+        for (std::size_t i = 0; i < ops; ++i)
+            op();
+        std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - start;
+        return elapsed.count();
+    }
+
+    static void printRow(const BenchmarkResult &r)
+    {
+        std::printf("%-40s min %9.2f  median %9.2f  p99 %9.2f  ns/op",
+                    r.name.c_str(), r.minNs, r.medianNs, r.p99Ns);
+        static const char *const columns[PerfCounters::EventCount] = {
+            "cyc", "ins", "br-miss", "L1d-miss", "LLC-miss"};
+        for (int e = 0; e < PerfCounters::EventCount; ++e)
+            if (r.perOp[e] >= 0)
+                std::printf("  %s %.2f", columns[e], r.perOp[e]);
+        std::printf("\n");
+        std::fflush(stdout);
+    }
+
+    std::string _name;
+    std::vector<BenchmarkResult> _results;
+    PerfCounters _counters;
+};
+
+#endif // BENCHMARK_H
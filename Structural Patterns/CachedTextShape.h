@@ -0,0 +1,258 @@
+#ifndef CACHED_TEXT_SHAPE_H
+#define CACHED_TEXT_SHAPE_H
+
+#include "Shape.h"
+
+/*************************************************************************
+ * TextShapes that cache their bounding box.
+ *
+ * TextShape::BoundingBox calls GetOrigin and GetExtent and adds them up
+ * on every call, although text rarely moves. A CachedTextShape keeps the
+ * last box it computed and watches an ObservableTextView: a change to
+ * the view's origin or extent only marks the box dirty, and the next
+ * BoundingBox recomputes it. Until then BoundingBox is two loads.
+ *
+ * Only an ObservableTextView can be watched, and only it pays for the
+ * observer list: a plain TextView stays as small as it was, and the
+ * plain TextShapes with it.
+ *
+ * BoundingBox fills the cache through mutable members, so two threads
+ * must not ask a dirty shape for its box at the same time.
+ *************************************************************************/
+
+class ObservableTextView;
+
+/**
+ * Told whenever the origin or extent of an ObservableTextView it
+ * watches changes. The view keeps its observers in an intrusive list,
+ * so watching one costs the view a single pointer and the observer
+ * another.
+ */
+class TextViewObserver
+{
+public:
+    virtual void TextViewChanged(const ObservableTextView *view) = 0;
+
+protected:
+    TextViewObserver() : _nextObserver(nullptr) {}
+    TextViewObserver(const TextViewObserver &) : _nextObserver(nullptr) {}
+    TextViewObserver &operator=(const TextViewObserver &) { return *this; }
+    ~TextViewObserver() {}
+
+private:
+    friend class ObservableTextView;
+    TextViewObserver *_nextObserver;
+};
+
+/**
+ * A TextView that clients may move and that tells its observers when
+ * they do. It costs one pointer more than a TextView.
+ */
+class ObservableTextView : public TextView
+{
+public:
+    ObservableTextView(Coord x = 0, Coord y = 0, Coord width = 0, Coord height = 0)
+        : TextView(x, y, width, height), _observers(nullptr) {}
+
+    // A copy has the same geometry but nobody watching it yet.
+    ObservableTextView(const ObservableTextView &other) : TextView(other), _observers(nullptr) {}
+
+    // Keeps this view's observers and tells them about the new geometry.
+    ObservableTextView &operator=(const ObservableTextView &other)
+    {
+        TextView::operator=(other);
+        Notify();
+        return *this;
+    }
+
+    void SetOrigin(Coord x, Coord y)
+    {
+        TextView::SetOrigin(x, y);
+        Notify();
+    }
+    void SetExtent(Coord width, Coord height)
+    {
+        TextView::SetExtent(width, height);
+        Notify();
+    }
+
+    // An observer must detach before it is destroyed.
+    void Attach(TextViewObserver *observer) const
+    {
+        observer->_nextObserver = _observers;
+        _observers = observer;
+    }
+    void Detach(TextViewObserver *observer) const
+    {
+        for (TextViewObserver **link = &_observers; *link; link = &(*link)->_nextObserver)
+        {
+            if (*link == observer)
+            {
+                *link = observer->_nextObserver;
+                observer->_nextObserver = nullptr;
+                return;
+            }
+        }
+    }
+
+private:
+    void Notify() const
+    {
+        for (TextViewObserver *observer = _observers; observer; observer = observer->_nextObserver)
+            observer->TextViewChanged(this);
+    }
+
+    mutable TextViewObserver *_observers;
+};
+
+namespace ClassAdapter
+{
+/**
+ * The class adapter watches the ObservableTextView it inherits.
+ * SetOrigin and SetExtent are made public so that clients can move the
+ * text.
+ */
+class CachedTextShape : public Shape, private ObservableTextView, private TextViewObserver
+{
+public:
+    CachedTextShape(Coord x = 0, Coord y = 0, Coord width = 0, Coord height = 0)
+        : ObservableTextView(x, y, width, height), _dirty(true)
+    {
+        Attach(this);
+    }
+
+    CachedTextShape(const CachedTextShape &other)
+        : Shape(other), ObservableTextView(other), TextViewObserver(other), _dirty(true)
+    {
+        Attach(this);
+    }
+
+    CachedTextShape &operator=(const CachedTextShape &other)
+    {
+        ObservableTextView::operator=(other);
+        return *this;
+    }
+
+    virtual ~CachedTextShape() { Detach(this); }
+
+    using ObservableTextView::SetOrigin;
+    using ObservableTextView::SetExtent;
+
+    virtual void BoundingBox(Point &bottomLeft, Point &topRight) const
+    {
+        if (_dirty)
+        {
+            Coord bottom, left, width, height;
+            GetOrigin(bottom, left);
+            GetExtent(width, height);
+            _bottomLeft = Point(bottom, left);
+            _topRight = Point(bottom + height, left + width);
+            _dirty = false;
+        }
+        bottomLeft = _bottomLeft;
+        topRight = _topRight;
+    }
+
+    virtual bool IsEmpty() const
+    {
+        return TextView::IsEmpty();
+    }
+
+    virtual ManipulatorHandle CreateManipulator() const
+    {
+        return ManipulatorPool::Create<TextManipulator>(this);
+    }
+
+    virtual BoundsKernel GetBoundsKernel() const
+    {
+        return KernelFor<CachedTextShape>();
+    }
+
+private:
+    virtual void TextViewChanged(const ObservableTextView *)
+    {
+        _dirty = true;
+    }
+
+    mutable Point _bottomLeft, _topRight;
+    mutable bool _dirty;
+};
+} // namespace ClassAdapter
+
+namespace ObjectAdapter
+{
+/**
+ * The object adapter watches the view it points to, so changes made
+ * through any other handle on that view still invalidate the cache.
+ */
+class CachedTextShape : public Shape, private TextViewObserver
+{
+public:
+    CachedTextShape(ObservableTextView *t) : _text(t), _dirty(true)
+    {
+        _text->Attach(this);
+    }
+
+    CachedTextShape(const CachedTextShape &other)
+        : Shape(other), TextViewObserver(other), _text(other._text), _dirty(true)
+    {
+        _text->Attach(this);
+    }
+
+    CachedTextShape &operator=(const CachedTextShape &other)
+    {
+        if (_text != other._text)
+        {
+            _text->Detach(this);
+            _text = other._text;
+            _text->Attach(this);
+            _dirty = true;
+        }
+        return *this;
+    }
+
+    virtual ~CachedTextShape() { _text->Detach(this); }
+
+    virtual void BoundingBox(Point &bottomLeft, Point &topRight) const
+    {
+        if (_dirty)
+        {
+            Coord bottom, left, width, height;
+            _text->GetOrigin(bottom, left);
+            _text->GetExtent(width, height);
+            _bottomLeft = Point(bottom, left);
+            _topRight = Point(bottom + height, left + width);
+            _dirty = false;
+        }
+        bottomLeft = _bottomLeft;
+        topRight = _topRight;
+    }
+
+    virtual bool IsEmpty() const
+    {
+        return _text->IsEmpty();
+    }
+
+    virtual ManipulatorHandle CreateManipulator() const
+    {
+        return ManipulatorPool::Create<TextManipulator>(this);
+    }
+
+    virtual BoundsKernel GetBoundsKernel() const
+    {
+        return KernelFor<CachedTextShape>();
+    }
+
+private:
+    virtual void TextViewChanged(const ObservableTextView *)
+    {
+        _dirty = true;
+    }
+
+    ObservableTextView *_text;
+    mutable Point _bottomLeft, _topRight;
+    mutable bool _dirty;
+};
+} // namespace ObjectAdapter
+
+#endif // CACHED_TEXT_SHAPE_H
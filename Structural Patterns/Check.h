@@ -0,0 +1,54 @@
+#ifndef CHECK_H
+#define CHECK_H
+
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+
+/**
+ * What the checks run by ctest share.
+ *
+ * check() reports a failed condition and counts it in failures; a check
+ * exits non-zero if any failed. A check that defines
+ * CHECK_COUNT_ALLOCATIONS before including this header also replaces
+ * operator new and delete with versions that keep liveAllocations, the
+ * number of blocks not yet freed, across every thread of the program.
+ * Each check is a single translation unit, so the replacements are
+ * defined once.
+ */
+inline int failures = 0;
+
+inline void check(bool ok, const char *what)
+{
+  if (!ok)
+  {
+    std::fprintf(stderr, "FAILED: %s\n", what);
+    ++failures;
+  }
+}
+
+#ifdef CHECK_COUNT_ALLOCATIONS
+inline std::atomic<long> liveAllocations(0);
+
+void *operator new(std::size_t size)
+{
+  void *p = std::malloc(size ? size : 1);
+  if (!p)
+    throw std::bad_alloc();
+  ++liveAllocations;
+  return p;
+}
+
+void operator delete(void *p) noexcept
+{
+  if (!p)
+    return;
+  --liveAllocations;
+  std::free(p);
+}
+
+void operator delete(void *p, std::size_t) noexcept { operator delete(p); }
+#endif
+
+#endif // CHECK_H
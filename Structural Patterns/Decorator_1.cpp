@@ -1,86 +1,14 @@
 #include <iostream>
+#include "Backpack.h"
+#include "StaticBackpack.h"
+#include "BackpackArena.h"
+#include "BackpackFusion.h"
+#include "BackpackWalk.h"
+#include "BackpackChain.h"
+#include "BackpackBatch.h"
+#include "BackpackCache.h"
 using namespace std;
 
-class IBackpack
-{
-public:
-  virtual void assemble() = 0;
-  virtual ~IBackpack() {}
-};
-
-// A plain backpack only has shoulder straps.
-class PlainBackpack : public IBackpack
-{
-public:
-  virtual void assemble() 
-  { 
-    cout << "\n ShoulderStraps and mainCompartment"; 
-  }
-};
-
-/**
- * Now, let's decorate the PlainBackpack.
- * 
- * IBackpack object is used to delegate the implementation of 
- * the assemble() method depending on the type of m_decorator.
- */
-class BackpackDecorator : public IBackpack
-{
-public:
-  BackpackDecorator(IBackpack *decorator) : m_Decorator(decorator) {}
-
-  virtual void assemble()
-  {
-    m_Decorator->assemble();
-  }
-
-private:
-  IBackpack *m_Decorator;
-};
-
-/**
- * Concrete Decorators.
- * 
- * Below three concrete Decorators are all identical apart from
- * the implementation of assemble().
- * 
- * The first, adds a laptopSlot;
- * The second, adds a USBCharge;
- * The third, adds a waterBottle.
- */
-class WithLaptopSlot : public BackpackDecorator
-{
-public:
-  WithLaptopSlot(IBackpack *dcrator) : BackpackDecorator(dcrator) {}
-  virtual void assemble()
-  {
-    BackpackDecorator::assemble();
-    cout << " + LaptopSlot";
-  }
-};
-
-class WithUSBCharge : public BackpackDecorator
-{
-public:
-  WithUSBCharge(IBackpack *dcrator) : BackpackDecorator(dcrator) {}
-  virtual void assemble()
-  {
-    BackpackDecorator::assemble();
-    cout << " + USBCharge";
-  }
-};
-
-class WithWaterBottle : public BackpackDecorator
-{
-public:
-  WithWaterBottle(IBackpack *dcrator) : BackpackDecorator(dcrator) {}
-  virtual void assemble()
-  {
-    BackpackDecorator::assemble();
-    cout << " + WaterBottle";
-  }
-};
-
 /**
  * "Wrapping a gift, putting it in a box, and wrapping the box ..."
  * 
@@ -104,11 +32,100 @@ int main()
                       new PlainBackpack())))); //1
 
   pBackpack->assemble();
-  delete pBackpack;
+
+  /**
+   * Fusing the chain drops the forwarding BackpackDecorator (2) and
+   * merges decorators 3-5 into one node: two indirect calls instead of
+   * five, same output.
+   */
+  IBackpack *pFused = fuse(pBackpack);
+  pFused->assemble();
+
+  /**
+   * Assembling into a sink instead of cout: the whole batch lands in
+   * one buffer and is written with a single call.
+   */
+  BackpackSink sink(256);
+  pBackpack->assemble(sink);
+  pFused->assemble(sink);
+  sink.writeTo(cout);
+
+  /**
+   * The same backpack stored as data: a feature bitmask plus the order
+   * the features were added in. A batch of these assembles in one pass
+   * without any chain at all.
+   */
+  BackpackBatch batch;
+  batch.add(pBackpack);
+  batch.add({Feature::LaptopSlot, Feature::USBCharge, Feature::WaterBottle});
+  sink.clear();
+  batch.assemble(sink);
+  sink.writeTo(cout);
+
+  /**
+   * Assembling through a cache: the first call walks and formats the
+   * chain, later calls with any chain of the same shape only look up
+   * the description.
+   */
+  BackpackCache cache;
+  cache.assemble(pBackpack);
+
+  if (pFused != pBackpack)
+    delete pFused;
+
+  /**
+   * The decorators don't own what they wrap, so `delete pBackpack` would
+   * only free the water bottle layer. destroyChain() frees all five.
+   */
+  destroyChain(pBackpack);
+
+  /**
+   * The same backpack with the chain fixed at compile time.
+   * Reading left to right this time: PlainBackpack first, then each
+   * feature in the order it is added.
+   */
+  Decorated<PlainBackpack, LaptopSlot, USBCharge, WaterBottle> staticBackpack;
+  IBackpack &rBackpack = staticBackpack;
+  rBackpack.assemble();
+
+  /**
+   * The same run-time chain again, but with every layer placed in one
+   * arena block: one allocation to build it, one to free it.
+   */
+  ArenaChain<PlainBackpack, BackpackDecorator, WithLaptopSlot,
+             WithUSBCharge, WithWaterBottle>
+      arenaBackpack;
+  arenaBackpack->assemble();
+
+  /**
+   * An owning chain: each wrap() moves the chain so far inside a new
+   * decorator, and every layer is freed when the chain goes out of scope.
+   */
+  BackpackChain ownedBackpack = BackpackChain::make<PlainBackpack>();
+  ownedBackpack.wrap<WithLaptopSlot>().wrap<WithUSBCharge>().wrap<WithWaterBottle>();
+  ownedBackpack->assemble();
 
   return 0;
 }
 // Output
 // ShoulderStraps and mainCompartment + LaptopSlot + USBCharge
 // + WaterBottle
+// ShoulderStraps and mainCompartment + LaptopSlot + USBCharge
+// + WaterBottle
+// ShoulderStraps and mainCompartment + LaptopSlot + USBCharge
+// + WaterBottle
+// ShoulderStraps and mainCompartment + LaptopSlot + USBCharge
+// + WaterBottle
+// ShoulderStraps and mainCompartment + LaptopSlot + USBCharge
+// + WaterBottle
+// ShoulderStraps and mainCompartment + LaptopSlot + USBCharge
+// + WaterBottle
+// ShoulderStraps and mainCompartment + LaptopSlot + USBCharge
+// + WaterBottle
+// ShoulderStraps and mainCompartment + LaptopSlot + USBCharge
+// + WaterBottle
+// ShoulderStraps and mainCompartment + LaptopSlot + USBCharge
+// + WaterBottle
+// ShoulderStraps and mainCompartment + LaptopSlot + USBCharge
+// + WaterBottle
 
@@ -0,0 +1,240 @@
+#ifndef HOT_BACKPACK_H
+#define HOT_BACKPACK_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+#include "Backpack.h"
+#include "BackpackChain.h"
+#include "BackpackWalk.h"
+
+/**
+ * Reader slots.
+ *
+ * Every thread that reads a HotBackpack is given a small index on its
+ * first read, and hands it back when it exits. Each HotBackpack keeps
+ * one slot per index, so a reader always knows which slot is its own
+ * without searching or locking.
+ */
+class ReaderIndex
+{
+public:
+  static const std::size_t MaxReaders = 128;
+
+  // This thread's index. Throws if more than MaxReaders threads read.
+  static std::size_t current()
+  {
+    thread_local Lease lease;
+    return lease.index;
+  }
+
+private:
+  struct Pool
+  {
+    std::mutex mutex;
+    std::vector<std::size_t> free;
+    std::size_t next = 0;
+  };
+
+  static Pool &pool()
+  {
+    static Pool pool;
+    return pool;
+  }
+
+  struct Lease
+  {
+    std::size_t index;
+
+    Lease()
+    {
+      Pool &p = pool();
+      std::lock_guard<std::mutex> lock(p.mutex);
+      if (!p.free.empty())
+      {
+        index = p.free.back();
+        p.free.pop_back();
+      }
+      else if (p.next < MaxReaders)
+        index = p.next++;
+      else
+        throw std::runtime_error("too many HotBackpack reader threads");
+    }
+
+    ~Lease()
+    {
+      Pool &p = pool();
+      std::lock_guard<std::mutex> lock(p.mutex);
+      p.free.push_back(index);
+    }
+  };
+};
+
+/**
+ * Hot-swappable chain.
+ *
+ * Many threads assemble the chain while a writer replaces it with a
+ * reconfigured one. Readers never lock: read() writes the current epoch
+ * into the thread's own slot, then loads the chain pointer, and the
+ * returned guard clears the slot when it goes out of scope. Nested
+ * reads on one thread share the slot, which is cleared when the last
+ * of their guards goes, whatever order they go in.
+ *
+ * publish() swaps in the new chain, retires the old one under the
+ * epoch it was replaced in, and advances the epoch. A retired chain is
+ * freed once every slot is either idle or shows a later epoch, since
+ * any reader that could still be using it announced an earlier one.
+ *
+ *     HotBackpack hot(BackpackChain::make<PlainBackpack>());
+ *
+ *     // reader threads
+ *     HotBackpack::ReadGuard backpack = hot.read();
+ *     backpack->assemble(sink);
+ *
+ *     // writer
+ *     hot.publish(std::move(reconfigured));
+ */
+class HotBackpack
+{
+  struct Slot;
+
+public:
+  explicit HotBackpack(BackpackChain chain)
+      : m_Current(chain.release()), m_Epoch(1)
+  {
+    for (Slot &slot : m_Slots)
+      slot.epoch.store(Idle, std::memory_order_relaxed);
+  }
+
+  // No reader may be active when the holder is destroyed.
+  ~HotBackpack()
+  {
+    destroyChain(m_Current.load());
+    for (const Retired &retired : m_Retired)
+      destroyChain(retired.chain);
+  }
+
+  HotBackpack(const HotBackpack &) = delete;
+  HotBackpack &operator=(const HotBackpack &) = delete;
+
+  /**
+   * A pinned snapshot of the chain. It stays valid, even if a new one
+   * is published, until the guard is destroyed. Guards are not to be
+   * handed to other threads.
+   */
+  class ReadGuard
+  {
+  public:
+    ReadGuard(ReadGuard &&other) noexcept
+        : m_Slot(other.m_Slot), m_Chain(other.m_Chain)
+    {
+      other.m_Slot = nullptr;
+    }
+    ReadGuard(const ReadGuard &) = delete;
+    ReadGuard &operator=(const ReadGuard &) = delete;
+    ReadGuard &operator=(ReadGuard &&) = delete;
+
+    ~ReadGuard()
+    {
+      if (m_Slot && --m_Slot->guards == 0)
+        m_Slot->epoch.store(Idle, std::memory_order_release);
+    }
+
+    IBackpack *get() const { return m_Chain; }
+    IBackpack *operator->() const { return m_Chain; }
+
+  private:
+    friend class HotBackpack;
+    ReadGuard(Slot *slot, IBackpack *chain) : m_Slot(slot), m_Chain(chain) {}
+
+    Slot *m_Slot;
+    IBackpack *m_Chain;
+  };
+
+  ReadGuard read()
+  {
+    Slot &slot = m_Slots[ReaderIndex::current()];
+    // If another guard on this thread is alive, its epoch is at least as
+    // old as the current one and covers this read too; the slot stays
+    // pinned until every guard sharing it is gone.
+    if (slot.guards++ == 0)
+      slot.epoch.store(m_Epoch.load());
+    return ReadGuard(&slot, m_Current.load());
+  }
+
+  void assemble(BackpackSink &sink) { read()->assemble(sink); }
+
+  // Replace the chain. Readers that already hold a guard keep the old one.
+  void publish(BackpackChain chain)
+  {
+    std::lock_guard<std::mutex> lock(m_WriterMutex);
+    IBackpack *old = m_Current.exchange(chain.release());
+    std::uint64_t epoch = m_Epoch.fetch_add(1);
+    m_Retired.push_back(Retired{epoch, old});
+    reclaim();
+  }
+
+  // Free retired chains no reader can still see. publish() calls this.
+  void collect()
+  {
+    std::lock_guard<std::mutex> lock(m_WriterMutex);
+    reclaim();
+  }
+
+  // Number of replaced chains not yet freed.
+  std::size_t retired() const
+  {
+    std::lock_guard<std::mutex> lock(m_WriterMutex);
+    return m_Retired.size();
+  }
+
+private:
+  static const std::uint64_t Idle = ~std::uint64_t(0);
+
+  struct alignas(64) Slot
+  {
+    std::atomic<std::uint64_t> epoch;
+    // Live guards on the owning thread; only that thread touches it.
+    std::size_t guards = 0;
+  };
+
+  struct Retired
+  {
+    std::uint64_t epoch;
+    IBackpack *chain;
+  };
+
+  void reclaim()
+  {
+    std::uint64_t oldest = Idle;
+    for (const Slot &slot : m_Slots)
+    {
+      std::uint64_t epoch = slot.epoch.load();
+      if (epoch < oldest)
+        oldest = epoch;
+    }
+
+    std::size_t kept = 0;
+    for (const Retired &retired : m_Retired)
+    {
+      if (retired.epoch < oldest)
+        destroyChain(retired.chain);
+      else
+        m_Retired[kept++] = retired;
+    }
+    m_Retired.resize(kept);
+  }
+
+  std::atomic<IBackpack *> m_Current;
+  std::atomic<std::uint64_t> m_Epoch;
+  Slot m_Slots[ReaderIndex::MaxReaders];
+
+  mutable std::mutex m_WriterMutex;
+  std::vector<Retired> m_Retired;
+};
+
+#endif // HOT_BACKPACK_H
@@ -0,0 +1,150 @@
+#include <atomic>
+#include <cstdio>
+#include <string>
+#include <thread>
+#include <vector>
+#include "Backpack.h"
+#include "BackpackChain.h"
+#include "BackpackFixtures.h"
+#define CHECK_COUNT_ALLOCATIONS
+#include "Check.h"
+#include "HotBackpack.h"
+using namespace std;
+
+/**
+ * Stress check for HotBackpack.
+ *
+ * Reader threads assemble the chain as fast as they can while a writer
+ * publishes thousands of replacements. Every description a reader gets
+ * must be one that some published chain produces, and once the readers
+ * are gone every replaced chain must have been freed. The allocation
+ * counter in Check.h sees every operator new and delete in the program.
+ *
+ * A use after free may still go unnoticed here; build with
+ * -fsanitize=address or -fsanitize=thread to catch those.
+ */
+
+static const int Depths = 5;
+
+static string describe(IBackpack *chain)
+{
+  BackpackSink sink;
+  chain->assemble(sink);
+  return sink.str();
+}
+
+static void stress(int readerCount, int publishes)
+{
+  vector<string> expected;
+  for (int depth = 0; depth < Depths; ++depth)
+    expected.push_back(describe(virtualChain(depth).get()));
+
+  // ReaderIndex keeps a list of the indices exiting threads hand back;
+  // let it grow to size before counting.
+  {
+    HotBackpack warm(virtualChain(0));
+    vector<thread> threads;
+    for (int r = 0; r < readerCount; ++r)
+      threads.emplace_back([&] { warm.read(); });
+    for (thread &t : threads)
+      t.join();
+  }
+
+  const long baseline = liveAllocations;
+  {
+    HotBackpack hot(virtualChain(0));
+    atomic<bool> done(false);
+    atomic<long> reads(0), bad(0);
+
+    vector<thread> readers;
+    for (int r = 0; r < readerCount; ++r)
+      readers.emplace_back([&] {
+        long mine = 0;
+        while (!done.load(memory_order_relaxed))
+        {
+          HotBackpack::ReadGuard backpack = hot.read();
+          string first = describe(backpack.get());
+          // A nested read on the same thread sees a chain at least as new.
+          string nested = describe(hot.read().get());
+          bool known = false, nestedKnown = false;
+          for (const string &description : expected)
+          {
+            known |= first == description;
+            nestedKnown |= nested == description;
+          }
+          if (!known || !nestedKnown || describe(backpack.get()) != first)
+            ++bad;
+          ++mine;
+        }
+        reads += mine;
+      });
+
+    for (int i = 1; i <= publishes; ++i)
+    {
+      hot.publish(virtualChain(i % Depths));
+      if (i % 64 == 0)
+        this_thread::yield();
+    }
+    done = true;
+    for (thread &reader : readers)
+      reader.join();
+
+    check(bad == 0, "every read assembles a published chain, unchanged while pinned");
+    check(reads > 0, "readers made progress");
+    hot.collect();
+    check(hot.retired() == 0, "with no readers every replaced chain is freed");
+    check(describe(hot.read().get()) == expected[publishes % Depths], "the last chain published is current");
+    printf("HotBackpack: %d readers, %ld reads against %d publishes\n", readerCount, long(reads), publishes);
+  }
+  check(liveAllocations == baseline, "destroying the holder frees the heap back to baseline");
+}
+
+// Reader indices are handed back when a thread exits, so many more
+// threads than MaxReaders may read one after another.
+static void readerTurnover()
+{
+  HotBackpack hot(virtualChain(2));
+  const string expected = describe(hot.read().get());
+  atomic<int> good(0);
+  const int Threads = int(ReaderIndex::MaxReaders) * 3;
+  for (int i = 0; i < Threads; ++i)
+  {
+    thread reader([&] {
+      if (describe(hot.read().get()) == expected)
+        ++good;
+    });
+    reader.join();
+  }
+  check(good == Threads, "reader indices are reused after threads exit");
+}
+
+// A nested guard moved out of its outer guard's scope outlives it and
+// must keep its chain pinned on its own.
+static void nestedGuardOutlivesOuter()
+{
+  HotBackpack hot(virtualChain(1));
+  const string expected = describe(hot.read().get());
+  HotBackpack::ReadGuard inner = [&] {
+    HotBackpack::ReadGuard outer = hot.read();
+    return hot.read();
+  }();
+  hot.publish(virtualChain(2));
+  check(hot.retired() == 1, "a moved nested guard keeps the replaced chain from being freed");
+  check(describe(inner.get()) == expected, "a moved nested guard still assembles its chain");
+}
+
+int main()
+{
+  unsigned cores = thread::hardware_concurrency();
+  int readerCount = cores > 1 ? int(cores > 8 ? 8 : cores) - 1 : 1;
+  if (readerCount < 2)
+    readerCount = 2;
+
+  stress(readerCount, 3000);
+  readerTurnover();
+  nestedGuardOutlivesOuter();
+
+  if (failures)
+    return 1;
+  return 0;
+}
@@ -0,0 +1,306 @@
+#ifndef MANIPULATOR_H
+#define MANIPULATOR_H
+
+#include <cstddef>
+#include <mutex>
+#include <new>
+#include <utility>
+#include <vector>
+
+class Shape;
+
+/**
+ * Knows how to animate a shape when the user manipulates it.
+ */
+class Manipulator
+{
+public:
+    virtual ~Manipulator() {}
+};
+
+class TextManipulator : public Manipulator
+{
+public:
+    TextManipulator(const Shape *shape) : _shape(shape) {}
+    const Shape *GetShape() const { return _shape; }
+
+private:
+    const Shape *_shape;
+};
+
+/**
+ * Owns a Manipulator and gives it back to wherever it came from, the
+ * ManipulatorPool or the heap, when the handle is reset or destroyed.
+ * Move-only, like std::unique_ptr.
+ *
+ *     ManipulatorHandle manipulator = shape->CreateManipulator();
+ *     ...
+ *     manipulator.Reset(); // or let it go out of scope
+ */
+class ManipulatorHandle
+{
+public:
+    typedef void (*Destroy)(Manipulator *manipulator);
+
+    ManipulatorHandle() : _object(nullptr), _destroy(nullptr) {}
+    ManipulatorHandle(Manipulator *object, Destroy destroy) : _object(object), _destroy(destroy) {}
+
+    // Adopt a Manipulator allocated with new.
+    explicit ManipulatorHandle(Manipulator *object)
+        : _object(object), _destroy([](Manipulator *m) { delete m; }) {}
+
+    ManipulatorHandle(ManipulatorHandle &&other) noexcept : _object(other._object), _destroy(other._destroy)
+    {
+        other._object = nullptr;
+    }
+
+    ManipulatorHandle &operator=(ManipulatorHandle &&other) noexcept
+    {
+        if (this != &other)
+        {
+            Reset();
+            std::swap(_object, other._object);
+            _destroy = other._destroy;
+        }
+        return *this;
+    }
+
+    ManipulatorHandle(const ManipulatorHandle &) = delete;
+    ManipulatorHandle &operator=(const ManipulatorHandle &) = delete;
+
+    ~ManipulatorHandle() { Reset(); }
+
+    Manipulator *Get() const { return _object; }
+    Manipulator *operator->() const { return _object; }
+    Manipulator &operator*() const { return *_object; }
+    explicit operator bool() const { return _object != nullptr; }
+
+    void Reset() noexcept
+    {
+        if (_object)
+            _destroy(_object);
+        _object = nullptr;
+    }
+
+private:
+    Manipulator *_object;
+    Destroy _destroy;
+};
+
+/**
+ * Per-thread pool for Manipulators.
+ *
+ * A drag creates and drops a Manipulator on every mouse event. Create()
+ * takes the memory from a free list kept by the calling thread, one list
+ * per size class of Granularity bytes, so neither creating nor dropping
+ * one usually takes a lock or calls the allocator. A thread that runs
+ * out refills its list with a batch from a shared list, or carves a new
+ * chunk. A Manipulator may be dropped on any thread: a list that grows
+ * past MaxCachedBytes, as it does on a thread that only drops what
+ * another creates, hands half its blocks to the shared list, and when a
+ * thread exits all of its lists go there.
+ *
+ * Manipulators larger than MaxSize or aligned to more than Granularity
+ * bytes come from the heap. Chunks are never returned to the heap, but
+ * a new one is only carved when both the thread's list and the shared
+ * one are empty, so for each size class the pool holds at most the
+ * most Manipulators alive at once, plus MaxCachedBytes per thread and
+ * one chunk. A thread's lists die with the thread, so do not drop a
+ * pooled Manipulator from a static destructor.
+ */
+class ManipulatorPool
+{
+public:
+    static const std::size_t Granularity = 16;
+    static const std::size_t MaxSize = 256;
+    static const std::size_t ChunkSize = 16 * 1024;
+    static const std::size_t MaxCachedBytes = 2 * ChunkSize;
+
+    template <class T, class... Args>
+    static ManipulatorHandle Create(Args &&... args)
+    {
+        if constexpr (sizeof(T) > MaxSize || alignof(T) > Granularity)
+            return ManipulatorHandle(new T(std::forward<Args>(args)...));
+        else
+        {
+            void *block = Allocate(sizeof(T));
+            T *object;
+            try
+            {
+                object = new (block) T(std::forward<Args>(args)...);
+            }
+            catch (...)
+            {
+                Release(block, sizeof(T));
+                throw;
+            }
+            return ManipulatorHandle(object, [](Manipulator *m) {
+                T *object = static_cast<T *>(m);
+                object->~T();
+                Release(object, sizeof(T));
+            });
+        }
+    }
+
+    static void *Allocate(std::size_t size)
+    {
+        return Local().Pop(ClassOf(size));
+    }
+
+    static void Release(void *block, std::size_t size)
+    {
+        Local().Push(ClassOf(size), block);
+    }
+
+private:
+    static const std::size_t ClassCount = MaxSize / Granularity;
+
+    // Every block is at least Granularity bytes, room for both fields.
+    struct FreeBlock
+    {
+        FreeBlock *next;
+        std::size_t depth; // blocks from this one to the end of its thread's list
+    };
+
+    static std::size_t ClassOf(std::size_t size)
+    {
+        return size == 0 ? 0 : (size - 1) / Granularity;
+    }
+
+    // Most blocks of class c a thread keeps; it trades half as many at a time.
+    static std::size_t Limit(std::size_t c)
+    {
+        return MaxCachedBytes / ((c + 1) * Granularity);
+    }
+
+    // Blocks handed back by threads, and every chunk ever carved.
+    struct Shared
+    {
+        std::mutex mutex;
+        FreeBlock *free[ClassCount];
+        std::vector<void *> chunks;
+
+        Shared()
+        {
+            for (std::size_t c = 0; c < ClassCount; ++c)
+                free[c] = nullptr;
+        }
+    };
+
+    static Shared &GetShared()
+    {
+        // Never destroyed: Manipulators may outlive static destruction.
+        static Shared *shared = new Shared;
+        return *shared;
+    }
+
+    class Cache
+    {
+    public:
+        Cache()
+        {
+            GetShared();
+            for (std::size_t c = 0; c < ClassCount; ++c)
+                _free[c] = nullptr;
+        }
+
+        ~Cache()
+        {
+            Shared &shared = GetShared();
+            std::lock_guard<std::mutex> lock(shared.mutex);
+            for (std::size_t c = 0; c < ClassCount; ++c)
+            {
+                while (FreeBlock *block = _free[c])
+                {
+                    _free[c] = block->next;
+                    block->next = shared.free[c];
+                    shared.free[c] = block;
+                }
+            }
+        }
+
+        void *Pop(std::size_t c)
+        {
+            if (!_free[c])
+                Refill(c);
+            FreeBlock *block = _free[c];
+            _free[c] = block->next;
+            return block;
+        }
+
+        void Push(std::size_t c, void *p)
+        {
+            FreeBlock *block = static_cast<FreeBlock *>(p);
+            FreeBlock *below = _free[c];
+            block->next = below;
+            block->depth = below ? below->depth + 1 : 1;
+            _free[c] = block;
+            if (block->depth >= Limit(c))
+                Flush(c, Limit(c) / 2);
+        }
+
+    private:
+        // Take a batch from the shared list, or carve a new chunk.
+        void Refill(std::size_t c)
+        {
+            Shared &shared = GetShared();
+            FreeBlock *batch;
+            std::size_t count = 0;
+            char *chunk = nullptr;
+            {
+                std::lock_guard<std::mutex> lock(shared.mutex);
+                batch = shared.free[c];
+                if (batch)
+                {
+                    FreeBlock *last = batch;
+                    for (count = 1; count < Limit(c) / 2 && last->next; ++count)
+                        last = last->next;
+                    shared.free[c] = last->next;
+                    last->next = nullptr;
+                }
+                else
+                {
+                    chunk = static_cast<char *>(::operator new(ChunkSize));
+                    shared.chunks.push_back(chunk);
+                }
+            }
+            if (batch)
+            {
+                // Depths from another thread's list do not hold here.
+                _free[c] = batch;
+                for (FreeBlock *block = batch; block; block = block->next)
+                    block->depth = count--;
+                return;
+            }
+            // A chunk holds at most Limit(c) / 2 blocks, so this never flushes.
+            std::size_t blockSize = (c + 1) * Granularity;
+            for (std::size_t offset = 0; offset + blockSize <= ChunkSize; offset += blockSize)
+                Push(c, chunk + offset);
+        }
+
+        // Move the first count blocks of class c to the shared list; the
+        // depths of those left do not change.
+        void Flush(std::size_t c, std::size_t count)
+        {
+            FreeBlock *first = _free[c], *last = first;
+            for (std::size_t i = 1; i < count; ++i)
+                last = last->next;
+            _free[c] = last->next;
+
+            Shared &shared = GetShared();
+            std::lock_guard<std::mutex> lock(shared.mutex);
+            last->next = shared.free[c];
+            shared.free[c] = first;
+        }
+
+        FreeBlock *_free[ClassCount];
+    };
+
+    static Cache &Local()
+    {
+        thread_local Cache cache;
+        return cache;
+    }
+};
+
+#endif // MANIPULATOR_H
@@ -0,0 +1,117 @@
+#include <condition_variable>
+#include <cstdio>
+#include <mutex>
+#include <thread>
+#define CHECK_COUNT_ALLOCATIONS
+#include "Check.h"
+#include "Manipulator.h"
+using namespace std;
+
+/**
+ * Checks that ManipulatorPool stays bounded when one thread creates
+ * Manipulators and another drops them, the case where every block ends
+ * up on a thread that never allocates.
+ *
+ * Every operator new and delete in this program goes through a counter
+ * of live allocations, which sees each chunk the pool carves. Passing a
+ * million Manipulators from a producer to a consumer must carve only a
+ * handful of chunks, however many pass. Exits non-zero otherwise.
+ */
+
+template <size_t Size>
+class SizedManipulator : public Manipulator
+{
+    char _payload[Size - sizeof(Manipulator)];
+};
+
+/**
+ * A fixed ring of handles between one producer and one consumer. It
+ * allocates nothing itself, so the counter sees only the pool.
+ */
+class HandleQueue
+{
+public:
+    static const size_t Capacity = 256;
+
+    HandleQueue() : _head(0), _size(0) {}
+
+    void Push(ManipulatorHandle handle)
+    {
+        unique_lock<mutex> lock(_mutex);
+        _notFull.wait(lock, [&] { return _size < Capacity; });
+        _ring[(_head + _size++) % Capacity] = std::move(handle);
+        _notEmpty.notify_one();
+    }
+
+    ManipulatorHandle Pop()
+    {
+        unique_lock<mutex> lock(_mutex);
+        _notEmpty.wait(lock, [&] { return _size > 0; });
+        ManipulatorHandle handle = std::move(_ring[_head]);
+        _head = (_head + 1) % Capacity;
+        --_size;
+        _notFull.notify_one();
+        return handle;
+    }
+
+private:
+    mutex _mutex;
+    condition_variable _notFull, _notEmpty;
+    ManipulatorHandle _ring[Capacity];
+    size_t _head, _size;
+};
+
+/**
+ * Send count Manipulators of type T from a producer thread to a
+ * consumer thread that drops them; returns how many allocations the
+ * pool kept afterwards.
+ */
+template <class T>
+static long producerConsumer(size_t count)
+{
+    HandleQueue queue;
+    const long baseline = liveAllocations;
+    thread producer([&] {
+        for (size_t i = 0; i < count; ++i)
+            queue.Push(ManipulatorPool::Create<T>());
+    });
+    thread consumer([&] {
+        for (size_t i = 0; i < count; ++i)
+            queue.Pop().Reset();
+    });
+    producer.join();
+    consumer.join();
+    return liveAllocations - baseline;
+}
+
+int main()
+{
+    const size_t Count = 1000000;
+    const size_t MaxChunks = 16;
+
+    // One-off allocations: each thread's first run, the chunk list.
+    producerConsumer<SizedManipulator<16> >(1000);
+
+    long small = producerConsumer<SizedManipulator<16> >(Count);
+    long large = producerConsumer<SizedManipulator<ManipulatorPool::MaxSize> >(Count);
+    printf("ManipulatorPool: %zu handed across threads, %ld and %ld allocations kept for 16 and %zu bytes\n",
+           Count, small, large, ManipulatorPool::MaxSize);
+    check(small <= long(MaxChunks), "16-byte Manipulators dropped on another thread are reused");
+    check(large <= long(MaxChunks), "MaxSize Manipulators dropped on another thread are reused");
+
+    // A second round reuses what the first carved.
+    long again = producerConsumer<SizedManipulator<16> >(Count);
+    check(again <= 1, "a second round carves nothing new");
+
+    // Creating and dropping on one thread never needs a second chunk.
+    const long baseline = liveAllocations;
+    thread([&] {
+        for (size_t i = 0; i < Count; ++i)
+            ManipulatorPool::Create<SizedManipulator<48> >().Reset();
+    }).join();
+    check(liveAllocations - baseline <= 1, "one thread creating and dropping keeps at most one chunk");
+
+    if (failures)
+        return 1;
+    return 0;
+}
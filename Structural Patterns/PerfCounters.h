@@ -0,0 +1,147 @@
+#ifndef PERF_COUNTERS_H
+#define PERF_COUNTERS_H
+
+#include <cstdint>
+#include <cstring>
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+/**
+ * Hardware performance counters.
+ *
+ * On Linux each event is opened with perf_event_open for the calling
+ * thread, user space only. Only that thread is counted: work it hands
+ * to other threads, such as a pool's workers, does not show up, so
+ * counts for a multi-threaded operation undercount it. Events are opened one by one rather than as
+ * a group, so a machine that lacks one event (LLC misses inside a VM,
+ * say) still reports the others. When the kernel multiplexes counters
+ * the counts are scaled up by the share of time each one ran.
+ *
+ * Where counters cannot be opened at all (another OS, a container,
+ * perf_event_paranoid too strict) available() is false and every
+ * count reads as -1, so callers can print what they have and carry on.
+ */
+class PerfCounters
+{
+public:
+    enum Event
+    {
+        Cycles,
+        Instructions,
+        BranchMisses,
+        L1DMisses,
+        LLCMisses,
+        EventCount
+    };
+
+    static const char *name(Event event)
+    {
+        static const char *const names[EventCount] = {
+            "cycles", "instructions", "branch_misses", "l1d_misses", "llc_misses"};
+        return names[event];
+    }
+
+    PerfCounters()
+    {
+        for (int e = 0; e < EventCount; ++e)
+        {
+            _fd[e] = -1;
+            _count[e] = -1;
+        }
+#ifdef __linux__
+        struct Config
+        {
+            std::uint32_t type;
+            std::uint64_t config;
+        };
+        const Config configs[EventCount] = {
+            {PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES},
+            {PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS},
+            {PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES},
+            {PERF_TYPE_HW_CACHE, PERF_COUNT_HW_CACHE_L1D | (PERF_COUNT_HW_CACHE_OP_READ << 8) |
+                                     (PERF_COUNT_HW_CACHE_RESULT_MISS << 16)},
+            {PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES}};
+
+        for (int e = 0; e < EventCount; ++e)
+        {
+            perf_event_attr attr;
+            std::memset(&attr, 0, sizeof(attr));
+            attr.size = sizeof(attr);
+            attr.type = configs[e].type;
+            attr.config = configs[e].config;
+            attr.disabled = 1;
+            attr.exclude_kernel = 1;
+            attr.exclude_hv = 1;
+            attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+            _fd[e] = int(syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0));
+        }
+#endif
+    }
+
+    ~PerfCounters()
+    {
+#ifdef __linux__
+        for (int e = 0; e < EventCount; ++e)
+            if (_fd[e] >= 0)
+                close(_fd[e]);
+#endif
+    }
+
+    PerfCounters(const PerfCounters &) = delete;
+    PerfCounters &operator=(const PerfCounters &) = delete;
+
+    // Whether any event, or the given event, could be opened.
+    bool available() const
+    {
+        for (int e = 0; e < EventCount; ++e)
+            if (_fd[e] >= 0)
+                return true;
+        return false;
+    }
+    bool available(Event event) const { return _fd[event] >= 0; }
+
+    // Zero and start every available counter.
+    void start()
+    {
+#ifdef __linux__
+        for (int e = 0; e < EventCount; ++e)
+        {
+            if (_fd[e] < 0)
+                continue;
+            ioctl(_fd[e], PERF_EVENT_IOC_RESET, 0);
+            ioctl(_fd[e], PERF_EVENT_IOC_ENABLE, 0);
+        }
+#endif
+    }
+
+    // Stop every counter and take its count since start().
+    void stop()
+    {
+#ifdef __linux__
+        for (int e = 0; e < EventCount; ++e)
+        {
+            if (_fd[e] < 0)
+                continue;
+            ioctl(_fd[e], PERF_EVENT_IOC_DISABLE, 0);
+            std::uint64_t values[3];
+            if (read(_fd[e], values, sizeof(values)) != ssize_t(sizeof(values)) || values[2] == 0)
+                _count[e] = -1;
+            else
+                _count[e] = double(values[0]) * double(values[1]) / double(values[2]);
+        }
+#endif
+    }
+
+    // The count between the last start() and stop(), or -1 if unavailable.
+    double count(Event event) const { return _count[event]; }
+
+private:
+    int _fd[EventCount];
+    double _count[EventCount];
+};
+
+#endif // PERF_COUNTERS_H
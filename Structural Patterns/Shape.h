@@ -0,0 +1,206 @@
+#ifndef SHAPE_H
+#define SHAPE_H
+
+#include <cstddef>
+#include <typeinfo>
+#include "Manipulator.h"
+
+/*************************************************************************
+ * The classes from Adapter.cpp, filled in so that they compile.
+ *
+ * Adapter.cpp shows the class adapter and the object adapter one after
+ * the other under the same name, TextShape. Here they live side by side
+ * as ClassAdapter::TextShape and ObjectAdapter::TextShape so that both
+ * can be built, run and measured.
+ *************************************************************************/
+
+typedef float Coord;
+
+class Point
+{
+public:
+    Point(Coord x = 0, Coord y = 0) : x(x), y(y) {}
+    Coord x, y;
+};
+
+class Shape;
+
+/**
+ * Computes the bounding box of shapes[k] for k in [0, count), writing
+ * it to bottomLeft[indices[k]] and topRight[indices[k]]. A kernel is
+ * written for one exact dynamic type and only ever given shapes of
+ * that type, so it can call BoundingBox without a virtual call.
+ */
+class BoundsKernel
+{
+public:
+    typedef void (*Loop)(const Shape *const *shapes, const std::size_t *indices,
+                         std::size_t count, Point *bottomLeft, Point *topRight);
+
+    BoundsKernel(Loop loop = nullptr, const std::type_info *type = nullptr) : loop(loop), type(type) {}
+
+    Loop loop;
+    const std::type_info *type; // the type loop is written for
+};
+
+/**
+ * Target: the domain-specific interface that DrawingEditor uses.
+ */
+class Shape
+{
+public:
+    virtual ~Shape() {}
+    virtual void BoundingBox(Point &bottomLeft, Point &topRight) const = 0;
+    virtual bool IsEmpty() const = 0;
+    virtual ManipulatorHandle CreateManipulator() const = 0;
+
+    /**
+     * The kernel that computes BoundingBox for many shapes of this type
+     * at once, or an empty one to have them computed one virtual call
+     * at a time. A kernel is only used for shapes whose dynamic type is
+     * exactly its type, so a subclass that inherits its base's kernel
+     * falls back to virtual calls rather than to the base's BoundingBox.
+     */
+    virtual BoundsKernel GetBoundsKernel() const { return BoundsKernel(); }
+
+protected:
+    // The kernel for shapes of type T.
+    template <class T>
+    static BoundsKernel KernelFor()
+    {
+        return BoundsKernel(&BoundsLoop<T>, &typeid(T));
+    }
+
+    /**
+     * Calls T::BoundingBox by its qualified name, so the loop is free of
+     * virtual calls.
+     */
+    template <class T>
+    static void BoundsLoop(const Shape *const *shapes, const std::size_t *indices,
+                           std::size_t count, Point *bottomLeft, Point *topRight)
+    {
+        for (std::size_t k = 0; k < count; ++k)
+        {
+            std::size_t i = indices[k];
+            static_cast<const T *>(shapes[k])->T::BoundingBox(bottomLeft[i], topRight[i]);
+        }
+    }
+};
+
+/**
+ * Adaptee: the existing interface that needs adapting.
+ */
+class TextView
+{
+public:
+    TextView(Coord x = 0, Coord y = 0, Coord width = 0, Coord height = 0)
+        : _x(x), _y(y), _width(width), _height(height) {}
+    virtual ~TextView() {}
+
+    void GetOrigin(Coord &x, Coord &y) const
+    {
+        x = _x;
+        y = _y;
+    }
+    void GetExtent(Coord &width, Coord &height) const
+    {
+        width = _width;
+        height = _height;
+    }
+    virtual bool IsEmpty() const { return _width == 0 || _height == 0; }
+
+protected:
+    // For subclasses that let clients move the text; see ObservableTextView.
+    void SetOrigin(Coord x, Coord y)
+    {
+        _x = x;
+        _y = y;
+    }
+    void SetExtent(Coord width, Coord height)
+    {
+        _width = width;
+        _height = height;
+    }
+
+private:
+    Coord _x, _y, _width, _height;
+};
+
+namespace ClassAdapter
+{
+/**
+ * Inherits the interface publicly and the implementation privately.
+ */
+class TextShape : public Shape, private TextView
+{
+public:
+    TextShape(Coord x = 0, Coord y = 0, Coord width = 0, Coord height = 0)
+        : TextView(x, y, width, height) {}
+
+    virtual void BoundingBox(Point &bottomLeft, Point &topRight) const
+    {
+        Coord bottom, left, width, height;
+        GetOrigin(bottom, left);
+        GetExtent(width, height);
+        bottomLeft = Point(bottom, left);
+        topRight = Point(bottom + height, left + width);
+    }
+
+    virtual bool IsEmpty() const
+    {
+        return TextView::IsEmpty();
+    }
+
+    virtual ManipulatorHandle CreateManipulator() const
+    {
+        return ManipulatorPool::Create<TextManipulator>(this);
+    }
+
+    virtual BoundsKernel GetBoundsKernel() const
+    {
+        return KernelFor<TextShape>();
+    }
+};
+} // namespace ClassAdapter
+
+namespace ObjectAdapter
+{
+/**
+ * Keeps a pointer to the TextView it adapts. The client creates the
+ * TextView and keeps it alive for as long as the TextShape.
+ */
+class TextShape : public Shape
+{
+public:
+    TextShape(TextView *t) : _text(t) {}
+
+    virtual void BoundingBox(Point &bottomLeft, Point &topRight) const
+    {
+        Coord bottom, left, width, height;
+        _text->GetOrigin(bottom, left);
+        _text->GetExtent(width, height);
+        bottomLeft = Point(bottom, left);
+        topRight = Point(bottom + height, left + width);
+    }
+
+    virtual bool IsEmpty() const
+    {
+        return _text->IsEmpty();
+    }
+
+    virtual ManipulatorHandle CreateManipulator() const
+    {
+        return ManipulatorPool::Create<TextManipulator>(this);
+    }
+
+    virtual BoundsKernel GetBoundsKernel() const
+    {
+        return KernelFor<TextShape>();
+    }
+
+private:
+    TextView *_text;
+};
+} // namespace ObjectAdapter
+
+#endif // SHAPE_H
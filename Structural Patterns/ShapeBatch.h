@@ -0,0 +1,91 @@
+#ifndef SHAPE_BATCH_H
+#define SHAPE_BATCH_H
+
+#include <cstddef>
+#include <typeindex>
+#include <typeinfo>
+#include <vector>
+#include "Shape.h"
+
+/**
+ * Batched BoundingBox.
+ *
+ * DrawingEditor asks every shape for its bounding box, which costs a
+ * virtual BoundingBox call per shape plus the adaptee calls behind it.
+ * A ShapeBatch sorts a span of shapes into groups by dynamic type once,
+ * asks the first shape of each group for its BoundsKernel, and lays
+ * each group's shape pointers out contiguously. BoundingBoxes() then
+ * runs each group through its kernel in one tight loop with no virtual
+ * calls. A group whose kernel was written for some other type, such as
+ * a subclass that inherits its base's kernel, keeps the virtual call.
+ *
+ *     ShapeBatch batch(shapes.data(), shapes.size());
+ *     batch.BoundingBoxes(bottomLeft.data(), topRight.data());
+ *
+ * The output arrays are indexed like the input span, whatever the
+ * grouping. The batch keeps pointers to the shapes, so it must not
+ * outlive them. Build a new batch when the set of shapes changes.
+ */
+class ShapeBatch
+{
+public:
+    ShapeBatch(const Shape *const *shapes, std::size_t count)
+        : _count(count)
+    {
+        for (std::size_t i = 0; i < count; ++i)
+        {
+            Group &group = GroupFor(shapes[i]);
+            group.shapes.push_back(shapes[i]);
+            group.indices.push_back(i);
+        }
+    }
+
+    std::size_t Count() const { return _count; }
+
+    // Fill bottomLeft[0, Count()) and topRight[0, Count()).
+    void BoundingBoxes(Point *bottomLeft, Point *topRight) const
+    {
+        for (const Group &group : _groups)
+        {
+            std::size_t count = group.shapes.size();
+            if (group.loop)
+                group.loop(group.shapes.data(), group.indices.data(), count, bottomLeft, topRight);
+            else
+                for (std::size_t k = 0; k < count; ++k)
+                    group.shapes[k]->BoundingBox(bottomLeft[group.indices[k]], topRight[group.indices[k]]);
+        }
+    }
+
+private:
+    struct Group
+    {
+        std::type_index type;
+        BoundsKernel::Loop loop; // nullptr: one virtual call per shape
+        std::vector<const Shape *> shapes;
+        std::vector<std::size_t> indices;
+    };
+
+    Group &GroupFor(const Shape *shape)
+    {
+        std::type_index type(typeid(*shape));
+        for (Group &group : _groups)
+            if (group.type == type)
+                return group;
+        BoundsKernel kernel = shape->GetBoundsKernel();
+        BoundsKernel::Loop loop = kernel.type && *kernel.type == typeid(*shape) ? kernel.loop : nullptr;
+        _groups.push_back(Group{type, loop, std::vector<const Shape *>(), std::vector<std::size_t>()});
+        return _groups.back();
+    }
+
+    std::size_t _count;
+    std::vector<Group> _groups;
+};
+
+// One-off batch: group the shapes and compute all their boxes.
+inline void BoundingBoxes(const Shape *const *shapes, std::size_t count,
+                          Point *bottomLeft, Point *topRight)
+{
+    ShapeBatch(shapes, count).BoundingBoxes(bottomLeft, topRight);
+}
+
+#endif // SHAPE_BATCH_H
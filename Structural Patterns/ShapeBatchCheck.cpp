@@ -0,0 +1,96 @@
+#include <cstdio>
+#include <vector>
+#include "CachedTextShape.h"
+#include "Check.h"
+#include "Shape.h"
+#include "ShapeBatch.h"
+using namespace std;
+
+/**
+ * Checks that ShapeBatch gives every shape the box its own BoundingBox
+ * gives, whatever kernels the shapes hand out: in particular for a
+ * subclass that overrides BoundingBox but inherits its base's kernel.
+ * Exits non-zero otherwise.
+ */
+
+// Overrides BoundingBox and forgets GetBoundsKernel.
+class PaddedTextShape : public ClassAdapter::TextShape
+{
+public:
+    PaddedTextShape(Coord x, Coord y, Coord width, Coord height) : TextShape(x, y, width, height) {}
+
+    virtual void BoundingBox(Point &bottomLeft, Point &topRight) const
+    {
+        TextShape::BoundingBox(bottomLeft, topRight);
+        bottomLeft = Point(bottomLeft.x - 1, bottomLeft.y - 1);
+        topRight = Point(topRight.x + 1, topRight.y + 1);
+    }
+};
+
+// Has no kernel at all.
+class PointShape : public Shape
+{
+public:
+    PointShape(Coord x, Coord y) : _at(x, y) {}
+
+    virtual void BoundingBox(Point &bottomLeft, Point &topRight) const
+    {
+        bottomLeft = _at;
+        topRight = _at;
+    }
+    virtual bool IsEmpty() const { return true; }
+    virtual ManipulatorHandle CreateManipulator() const { return ManipulatorHandle(); }
+
+private:
+    Point _at;
+};
+
+int main()
+{
+    const size_t Count = 1000;
+    vector<TextView> views;
+    views.reserve(Count);
+    vector<Shape *> owned;
+    for (size_t i = 0; i < Count; ++i)
+    {
+        Coord c = Coord(i);
+        switch (i % 5)
+        {
+        case 0: owned.push_back(new ClassAdapter::TextShape(c, c + 1, 10, 20)); break;
+        case 1: owned.push_back(new PaddedTextShape(c, c + 1, 10, 20)); break;
+        case 2:
+            views.push_back(TextView(c, c + 1, 10, 20));
+            owned.push_back(new ObjectAdapter::TextShape(&views.back()));
+            break;
+        case 3: owned.push_back(new ClassAdapter::CachedTextShape(c, c + 1, 10, 20)); break;
+        case 4: owned.push_back(new PointShape(c, c + 1)); break;
+        }
+    }
+    vector<const Shape *> shapes(owned.begin(), owned.end());
+
+    vector<Point> bottomLeft(Count), topRight(Count);
+    ShapeBatch batch(shapes.data(), shapes.size());
+    check(batch.Count() == Count, "the batch holds every shape");
+    batch.BoundingBoxes(bottomLeft.data(), topRight.data());
+
+    size_t wrong = 0, paddedWrong = 0;
+    for (size_t i = 0; i < Count; ++i)
+    {
+        Point low, high;
+        shapes[i]->BoundingBox(low, high);
+        bool same = low.x == bottomLeft[i].x && low.y == bottomLeft[i].y &&
+                    high.x == topRight[i].x && high.y == topRight[i].y;
+        wrong += !same;
+        paddedWrong += !same && i % 5 == 1;
+    }
+    check(paddedWrong == 0, "a subclass that inherits a kernel keeps its own BoundingBox");
+    check(wrong == 0, "every batched box matches BoundingBox");
+
+    for (Shape *shape : owned)
+        delete shape;
+
+    if (failures)
+        return 1;
+    printf("ShapeBatch: %zu boxes across 5 shape types match BoundingBox\n", Count);
+    return 0;
+}
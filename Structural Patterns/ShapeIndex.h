@@ -0,0 +1,466 @@
+#ifndef SHAPE_INDEX_H
+#define SHAPE_INDEX_H
+
+#include <algorithm>
+#include <cstddef>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include "Shape.h"
+
+/**
+ * Spatial index over shapes.
+ *
+ * DrawingEditor finds the shape under the mouse by asking every shape
+ * for its BoundingBox. ShapeIndex keeps the boxes in a bounding volume
+ * hierarchy instead: a binary tree whose leaves hold one shape each and
+ * whose inner nodes hold the union of their children's boxes. A query
+ * only descends into nodes whose box it touches, so hit-testing costs
+ * O(log n) for shapes that do not overlap much.
+ *
+ *     ShapeIndex index;
+ *     index.BulkLoad(shapes.data(), shapes.size());
+ *     index.QueryPoint(mouse, [&](const Shape *shape) { hits.push_back(shape); });
+ *     index.Update(moved);
+ *
+ * BulkLoad() builds a balanced tree top-down, splitting each range of
+ * shapes at the median along its longer axis; the upper levels are
+ * built on separate threads. Insert() walks down to the sibling that
+ * grows the tree's surface least. A tree built mostly by Insert() can
+ * end up less balanced than a bulk-loaded one; Rebuild() restores it.
+ *
+ * The index reads each shape's box when the shape is inserted. Call
+ * Update() after a shape moves or changes size. The index keeps
+ * pointers to the shapes, so remove a shape before deleting it.
+ * Queries may run concurrently with each other but not with changes.
+ */
+class ShapeIndex
+{
+public:
+    struct Box
+    {
+        Coord minX, minY, maxX, maxY;
+    };
+
+    static Box BoxOf(const Shape *shape)
+    {
+        Point bottomLeft, topRight;
+        shape->BoundingBox(bottomLeft, topRight);
+        Box box = {std::min(bottomLeft.x, topRight.x), std::min(bottomLeft.y, topRight.y),
+                   std::max(bottomLeft.x, topRight.x), std::max(bottomLeft.y, topRight.y)};
+        return box;
+    }
+
+    ShapeIndex() : _root(Null), _free(Null) {}
+
+    std::size_t Size() const { return _leaves.size(); }
+    bool Contains(const Shape *shape) const { return _leaves.count(shape) != 0; }
+
+    void Clear()
+    {
+        _nodes.clear();
+        _leaves.clear();
+        _root = Null;
+        _free = Null;
+    }
+
+    // Add a shape, or update it if it is already in the index.
+    void Insert(const Shape *shape)
+    {
+        if (Contains(shape))
+        {
+            Update(shape);
+            return;
+        }
+        int leaf = NewNode();
+        _nodes[leaf].box = BoxOf(shape);
+        _nodes[leaf].shape = shape;
+        _leaves[shape] = leaf;
+        InsertLeaf(leaf);
+    }
+
+    // Remove a shape; returns false if it was not in the index.
+    bool Remove(const Shape *shape)
+    {
+        std::unordered_map<const Shape *, int>::iterator found = _leaves.find(shape);
+        if (found == _leaves.end())
+            return false;
+        int leaf = found->second;
+        _leaves.erase(found);
+        RemoveLeaf(leaf);
+        FreeNode(leaf);
+        return true;
+    }
+
+    // Re-read the box of a shape that moved or changed size.
+    bool Update(const Shape *shape)
+    {
+        std::unordered_map<const Shape *, int>::iterator found = _leaves.find(shape);
+        if (found == _leaves.end())
+            return false;
+        int leaf = found->second;
+        RemoveLeaf(leaf);
+        _nodes[leaf].box = BoxOf(shape);
+        InsertLeaf(leaf);
+        return true;
+    }
+
+    /**
+     * Replace the contents of the index with shapes[0, count), building
+     * a balanced tree on up to `threads` threads (0 for one per core).
+     * A shape that appears more than once is indexed once, as Insert()
+     * would.
+     */
+    void BulkLoad(const Shape *const *shapes, std::size_t count, unsigned threads = 0)
+    {
+        Clear();
+        if (count == 0)
+            return;
+        if (threads == 0)
+            threads = std::max(1u, std::thread::hardware_concurrency());
+
+        _leaves.reserve(count);
+        for (std::size_t i = 0; i < count; ++i)
+            _leaves.emplace(shapes[i], int(Null));
+        std::vector<const Shape *> unique;
+        if (_leaves.size() < count)
+        {
+            unique.reserve(_leaves.size());
+            for (std::size_t i = 0; i < count; ++i)
+            {
+                int &leaf = _leaves[shapes[i]];
+                if (leaf == Null)
+                {
+                    unique.push_back(shapes[i]);
+                    leaf = 0;
+                }
+            }
+            shapes = unique.data();
+            count = unique.size();
+        }
+
+        std::vector<Item> items(count);
+        ParallelRange(count, threads, [&](std::size_t begin, std::size_t end) {
+            for (std::size_t i = begin; i < end; ++i)
+            {
+                items[i].box = BoxOf(shapes[i]);
+                items[i].shape = shapes[i];
+            }
+        });
+
+        // A subtree over k shapes takes exactly 2k - 1 nodes, so every
+        // subtree knows its slots up front and threads never share one.
+        _nodes.resize(2 * count - 1);
+        int spawnDepth = 0;
+        while ((1u << spawnDepth) < threads)
+            ++spawnDepth;
+        Build(items.data(), 0, count, 0, Null, spawnDepth);
+        _root = 0;
+
+        for (std::size_t i = 0; i < _nodes.size(); ++i)
+            if (_nodes[i].IsLeaf())
+                _leaves[_nodes[i].shape] = int(i);
+    }
+
+    // Rebuild the tree from the shapes it holds, re-reading every box.
+    void Rebuild(unsigned threads = 0)
+    {
+        std::vector<const Shape *> shapes;
+        shapes.reserve(_leaves.size());
+        for (const std::pair<const Shape *const, int> &leaf : _leaves)
+            shapes.push_back(leaf.first);
+        BulkLoad(shapes.data(), shapes.size(), threads);
+    }
+
+    // Call visit(shape) for every shape whose box contains point.
+    template <class F>
+    void QueryPoint(const Point &point, F visit) const
+    {
+        Box box = {point.x, point.y, point.x, point.y};
+        Query(box, visit);
+    }
+
+    // Call visit(shape) for every shape whose box touches the rectangle.
+    template <class F>
+    void QueryRect(const Point &bottomLeft, const Point &topRight, F visit) const
+    {
+        Box box = {std::min(bottomLeft.x, topRight.x), std::min(bottomLeft.y, topRight.y),
+                   std::max(bottomLeft.x, topRight.x), std::max(bottomLeft.y, topRight.y)};
+        Query(box, visit);
+    }
+
+    // The height of the tree, 0 when empty; for checking its balance.
+    int Height() const { return _root == Null ? 0 : HeightOf(_root); }
+
+private:
+    static const int Null = -1;
+
+    struct Node
+    {
+        Box box;
+        int parent; // next free node while on the free list
+        int left, right;
+        const Shape *shape;
+
+        bool IsLeaf() const { return left == Null; }
+    };
+
+    struct Item
+    {
+        Box box;
+        const Shape *shape;
+    };
+
+    static Box Union(const Box &a, const Box &b)
+    {
+        Box box = {std::min(a.minX, b.minX), std::min(a.minY, b.minY),
+                   std::max(a.maxX, b.maxX), std::max(a.maxY, b.maxY)};
+        return box;
+    }
+
+    static Coord Perimeter(const Box &box)
+    {
+        return 2 * ((box.maxX - box.minX) + (box.maxY - box.minY));
+    }
+
+    static bool Overlaps(const Box &a, const Box &b)
+    {
+        return a.minX <= b.maxX && b.minX <= a.maxX && a.minY <= b.maxY && b.minY <= a.maxY;
+    }
+
+    // Run f(begin, end) over [0, count) split into one range per thread.
+    template <class F>
+    static void ParallelRange(std::size_t count, unsigned threads, F f)
+    {
+        std::size_t step = (count + threads - 1) / threads;
+        std::vector<std::thread> workers;
+        for (std::size_t begin = step; begin < count; begin += step)
+            workers.emplace_back(f, begin, std::min(count, begin + step));
+        f(0, std::min(count, step));
+        for (std::thread &worker : workers)
+            worker.join();
+    }
+
+    void Build(Item *items, std::size_t begin, std::size_t end, int node, int parent, int spawnDepth)
+    {
+        Node &n = _nodes[node];
+        n.parent = parent;
+        if (end - begin == 1)
+        {
+            n.box = items[begin].box;
+            n.left = n.right = Null;
+            n.shape = items[begin].shape;
+            return;
+        }
+
+        // Split at the median centre along the longer side of the centres' bounds.
+        Coord minX = items[begin].box.minX + items[begin].box.maxX, maxX = minX;
+        Coord minY = items[begin].box.minY + items[begin].box.maxY, maxY = minY;
+        for (std::size_t i = begin + 1; i < end; ++i)
+        {
+            Coord x = items[i].box.minX + items[i].box.maxX;
+            Coord y = items[i].box.minY + items[i].box.maxY;
+            minX = std::min(minX, x);
+            maxX = std::max(maxX, x);
+            minY = std::min(minY, y);
+            maxY = std::max(maxY, y);
+        }
+        std::size_t mid = begin + (end - begin) / 2;
+        if (maxX - minX >= maxY - minY)
+            std::nth_element(items + begin, items + mid, items + end, [](const Item &a, const Item &b) {
+                return a.box.minX + a.box.maxX < b.box.minX + b.box.maxX;
+            });
+        else
+            std::nth_element(items + begin, items + mid, items + end, [](const Item &a, const Item &b) {
+                return a.box.minY + a.box.maxY < b.box.minY + b.box.maxY;
+            });
+
+        int left = node + 1;
+        int right = node + int(2 * (mid - begin));
+        n.left = left;
+        n.right = right;
+        n.shape = nullptr;
+        if (spawnDepth > 0)
+        {
+            std::thread worker(&ShapeIndex::Build, this, items, begin, mid, left, node, spawnDepth - 1);
+            Build(items, mid, end, right, node, spawnDepth - 1);
+            worker.join();
+        }
+        else
+        {
+            Build(items, begin, mid, left, node, 0);
+            Build(items, mid, end, right, node, 0);
+        }
+        n.box = Union(_nodes[left].box, _nodes[right].box);
+    }
+
+    int NewNode()
+    {
+        int node;
+        if (_free != Null)
+        {
+            node = _free;
+            _free = _nodes[node].parent;
+        }
+        else
+        {
+            node = int(_nodes.size());
+            _nodes.push_back(Node());
+        }
+        _nodes[node].parent = _nodes[node].left = _nodes[node].right = Null;
+        _nodes[node].shape = nullptr;
+        return node;
+    }
+
+    void FreeNode(int node)
+    {
+        _nodes[node].parent = _free;
+        _free = node;
+    }
+
+    void InsertLeaf(int leaf)
+    {
+        if (_root == Null)
+        {
+            _root = leaf;
+            _nodes[leaf].parent = Null;
+            return;
+        }
+
+        // Walk down to the sibling whose union with the leaf adds the
+        // least perimeter to the tree, counting what it adds to every
+        // ancestor on the way.
+        const Box box = _nodes[leaf].box;
+        int sibling = _root;
+        while (!_nodes[sibling].IsLeaf())
+        {
+            const Node &node = _nodes[sibling];
+            Coord combined = Perimeter(Union(node.box, box));
+            Coord here = 2 * combined;
+            Coord inherited = 2 * (combined - Perimeter(node.box));
+            Coord costs[2];
+            int children[2] = {node.left, node.right};
+            for (int c = 0; c < 2; ++c)
+            {
+                const Node &child = _nodes[children[c]];
+                Coord grown = Perimeter(Union(child.box, box));
+                costs[c] = inherited + (child.IsLeaf() ? grown : grown - Perimeter(child.box));
+            }
+            if (here <= costs[0] && here <= costs[1])
+                break;
+            sibling = costs[0] <= costs[1] ? node.left : node.right;
+        }
+
+        int oldParent = _nodes[sibling].parent;
+        int parent = NewNode();
+        _nodes[parent].parent = oldParent;
+        _nodes[parent].left = sibling;
+        _nodes[parent].right = leaf;
+        _nodes[sibling].parent = parent;
+        _nodes[leaf].parent = parent;
+        if (oldParent == Null)
+            _root = parent;
+        else if (_nodes[oldParent].left == sibling)
+            _nodes[oldParent].left = parent;
+        else
+            _nodes[oldParent].right = parent;
+        Refit(parent);
+    }
+
+    // Unlink a leaf and free its parent; the leaf itself stays allocated.
+    void RemoveLeaf(int leaf)
+    {
+        if (leaf == _root)
+        {
+            _root = Null;
+            return;
+        }
+        int parent = _nodes[leaf].parent;
+        int grandparent = _nodes[parent].parent;
+        int sibling = _nodes[parent].left == leaf ? _nodes[parent].right : _nodes[parent].left;
+        _nodes[sibling].parent = grandparent;
+        if (grandparent == Null)
+            _root = sibling;
+        else
+        {
+            if (_nodes[grandparent].left == parent)
+                _nodes[grandparent].left = sibling;
+            else
+                _nodes[grandparent].right = sibling;
+            Refit(grandparent);
+        }
+        FreeNode(parent);
+    }
+
+    void Refit(int node)
+    {
+        for (; node != Null; node = _nodes[node].parent)
+            _nodes[node].box = Union(_nodes[_nodes[node].left].box, _nodes[_nodes[node].right].box);
+    }
+
+    template <class F>
+    void Query(const Box &box, F &visit) const
+    {
+        if (_root == Null)
+            return;
+        // A fixed stack covers any bulk-loaded tree; deeper ones spill.
+        int fixed[64];
+        std::vector<int> spill;
+        int top = 0;
+        fixed[top++] = _root;
+        while (top > 0 || !spill.empty())
+        {
+            int index;
+            if (!spill.empty())
+            {
+                index = spill.back();
+                spill.pop_back();
+            }
+            else
+                index = fixed[--top];
+
+            const Node &node = _nodes[index];
+            if (!Overlaps(node.box, box))
+                continue;
+            if (node.IsLeaf())
+            {
+                visit(node.shape);
+                continue;
+            }
+            for (int child : {node.right, node.left})
+            {
+                if (top < 64)
+                    fixed[top++] = child;
+                else
+                    spill.push_back(child);
+            }
+        }
+    }
+
+    int HeightOf(int root) const
+    {
+        int height = 0;
+        std::vector<std::pair<int, int> > stack(1, std::make_pair(root, 1));
+        while (!stack.empty())
+        {
+            std::pair<int, int> entry = stack.back();
+            stack.pop_back();
+            const Node &node = _nodes[entry.first];
+            height = std::max(height, entry.second);
+            if (!node.IsLeaf())
+            {
+                stack.push_back(std::make_pair(node.left, entry.second + 1));
+                stack.push_back(std::make_pair(node.right, entry.second + 1));
+            }
+        }
+        return height;
+    }
+
+    std::vector<Node> _nodes;
+    std::unordered_map<const Shape *, int> _leaves;
+    int _root;
+    int _free;
+};
+
+#endif // SHAPE_INDEX_H
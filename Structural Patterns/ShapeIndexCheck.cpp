@@ -0,0 +1,88 @@
+#include <algorithm>
+#include <cstdio>
+#include <vector>
+#include "Check.h"
+#include "Shape.h"
+#include "ShapeIndex.h"
+using namespace std;
+
+/**
+ * Checks ShapeIndex against a linear scan: after BulkLoad, including
+ * one given the same shape several times, and after Remove, Insert and
+ * Rebuild, every query must return exactly the shapes whose boxes it
+ * touches, each once. Exits non-zero otherwise.
+ */
+
+static vector<const Shape *> linearQuery(const vector<const Shape *> &live, const Point &point)
+{
+    vector<const Shape *> hits;
+    for (const Shape *shape : live)
+    {
+        ShapeIndex::Box box = ShapeIndex::BoxOf(shape);
+        if (box.minX <= point.x && point.x <= box.maxX && box.minY <= point.y && point.y <= box.maxY)
+            hits.push_back(shape);
+    }
+    sort(hits.begin(), hits.end());
+    return hits;
+}
+
+static bool matchesLinear(const ShapeIndex &index, const vector<const Shape *> &live)
+{
+    if (index.Size() != live.size())
+        return false;
+    for (int x = 0; x < 100; x += 3)
+        for (int y = 0; y < 100; y += 7)
+        {
+            Point point{Coord(x), Coord(y)};
+            vector<const Shape *> hits;
+            index.QueryPoint(point, [&](const Shape *shape) { hits.push_back(shape); });
+            sort(hits.begin(), hits.end());
+            if (hits != linearQuery(live, point))
+                return false;
+        }
+    return true;
+}
+
+int main()
+{
+    const size_t Count = 500;
+    vector<ClassAdapter::TextShape> owned;
+    owned.reserve(Count);
+    for (size_t i = 0; i < Count; ++i)
+        owned.emplace_back(Coord(i * 37 % 97), Coord(i * 53 % 89), Coord(1 + i % 9), Coord(1 + i % 5));
+
+    vector<const Shape *> live;
+    for (const ClassAdapter::TextShape &shape : owned)
+        live.push_back(&shape);
+
+    // Every shape once, then every third one again, shuffled in.
+    vector<const Shape *> input = live;
+    for (size_t i = 0; i < Count; i += 3)
+        input.push_back(live[i]);
+    reverse(input.begin() + Count / 2, input.end());
+
+    ShapeIndex index;
+    index.BulkLoad(input.data(), input.size(), 4);
+    check(index.Size() == Count, "a duplicated shape is indexed once");
+    check(matchesLinear(index, live), "bulk-loaded queries match a linear scan");
+
+    for (size_t i = 0; i < Count; i += 3)
+        check(index.Remove(live[i]), "remove a shape that was bulk-loaded twice");
+    vector<const Shape *> kept;
+    for (size_t i = 0; i < Count; ++i)
+        if (i % 3)
+            kept.push_back(live[i]);
+    check(matchesLinear(index, kept), "a removed duplicate leaves no orphan leaf");
+
+    for (size_t i = 0; i < Count; i += 3)
+        index.Insert(live[i]);
+    index.Insert(live[1]);
+    check(matchesLinear(index, live), "queries match after re-inserting");
+    index.Rebuild(2);
+    check(matchesLinear(index, live), "queries match after Rebuild");
+
+    if (failures)
+        return 1;
+    printf("ShapeIndex: %zu shapes, queries match a linear scan\n", Count);
+    return 0;
+}
@@ -0,0 +1,116 @@
+#ifndef STATIC_BACKPACK_H
+#define STATIC_BACKPACK_H
+
+#include <cstddef>
+#include <type_traits>
+#include "Backpack.h"
+
+/**
+ * A string of N characters built at compile time.
+ */
+template <std::size_t N>
+class FixedString
+{
+public:
+  constexpr FixedString() : m_Data{} {}
+
+  constexpr char &operator[](std::size_t i) { return m_Data[i]; }
+  constexpr const char *c_str() const { return m_Data; }
+  constexpr std::size_t size() const { return N; }
+
+private:
+  char m_Data[N + 1];
+};
+
+constexpr std::size_t labelLength(const char *label)
+{
+  std::size_t n = 0;
+  while (label[n])
+    ++n;
+  return n;
+}
+
+// The labels of Parts, in order, joined into one FixedString.
+template <class... Parts>
+constexpr auto joinLabels()
+{
+  constexpr std::size_t n = (labelLength(Parts::label) + ... + 0);
+  FixedString<n> joined;
+  std::size_t at = 0;
+  for (const char *label : {Parts::label...})
+    for (std::size_t i = 0; label[i]; ++i)
+      joined[at++] = label[i];
+  return joined;
+}
+
+/**
+ * Compile-time description.
+ *
+ * The description of a chain known at compile time is fully determined
+ * by its types, so it can be computed by the compiler and stored as a
+ * constant:
+ *
+ *     staticDescription<PlainBackpack, LaptopSlot, USBCharge>.c_str()
+ *
+ * is "\n ShoulderStraps and mainCompartment + LaptopSlot + USBCharge",
+ * costs nothing at run time, and lives in read-only data.
+ */
+template <class Base, class... Features>
+inline constexpr auto staticDescription = joinLabels<Base, Features...>();
+
+/**
+ * Static Decorator.
+ *
+ * When the chain is known at compile time there is no need to build it
+ * out of heap objects. Decorated<Base, Features...> derives from the
+ * component and appends the features' labels in order, so
+ *
+ *     Decorated<PlainBackpack, LaptopSlot, USBCharge, WaterBottle>
+ *
+ * assembles the same backpack as
+ *
+ *     new WithWaterBottle(new WithUSBCharge(new WithLaptopSlot(
+ *         new PlainBackpack())))
+ *
+ * Base::assemble() is called by its qualified name, so it is bound
+ * statically and the whole chain inlines into a single function. On a
+ * PlainBackpack the whole description is known at compile time, so
+ * Decorated writes its staticDescription in one go instead.
+ *
+ * Decorated is still an IBackpack: code that needs run-time polymorphism
+ * can hold it through an IBackpack pointer and pays one virtual call
+ * for the whole chain instead of one per layer.
+ */
+template <class Base, class... Features>
+class Decorated final : public Base
+{
+public:
+  virtual void assemble()
+  {
+    if constexpr (std::is_same<Base, PlainBackpack>::value)
+    {
+      constexpr auto &description = staticDescription<Base, Features...>;
+      std::cout.write(description.c_str(), description.size());
+    }
+    else
+    {
+      Base::assemble();
+      ((std::cout << Features::label), ...);
+    }
+  }
+  virtual void assemble(BackpackSink &sink)
+  {
+    if constexpr (std::is_same<Base, PlainBackpack>::value)
+    {
+      constexpr auto &description = staticDescription<Base, Features...>;
+      sink.append(description.c_str(), description.size());
+    }
+    else
+    {
+      Base::assemble(sink);
+      (sink.append(Features::label), ...);
+    }
+  }
+};
+
+#endif // STATIC_BACKPACK_H
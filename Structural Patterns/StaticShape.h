@@ -0,0 +1,167 @@
+#ifndef STATIC_SHAPE_H
+#define STATIC_SHAPE_H
+
+#include <algorithm>
+#include <concepts>
+#include <cstddef>
+#include <iterator>
+#include <type_traits>
+#include <utility>
+#include "Shape.h"
+
+/*************************************************************************
+ * Shapes without virtual functions.
+ *
+ * DrawingEditor only reaches a Shape through virtual calls. ShapeLike
+ * states the same interface as a concept, so an editor algorithm can be
+ * a template that is instantiated for one concrete shape type and
+ * inlined all the way down to the TextView. Shape itself is ShapeLike,
+ * so the same templates still serve mixed collections through Shape
+ * pointers.
+ *
+ *     std::vector<StaticAdapter::TextShape<>> texts = ...;
+ *     std::vector<const Shape *> mixed = ...;
+ *     Point bottomLeft, topRight;
+ *     BoundsUnion(texts, bottomLeft, topRight); // inlined
+ *     BoundsUnion(mixed, bottomLeft, topRight); // virtual calls
+ *     const Shape *hit = HitTest(mixed, mouse);
+ *************************************************************************/
+
+template <class S>
+concept ShapeLike = requires(const S &shape, Point &bottomLeft, Point &topRight) {
+    shape.BoundingBox(bottomLeft, topRight);
+    { shape.IsEmpty() } -> std::convertible_to<bool>;
+    { shape.CreateManipulator() } -> std::same_as<ManipulatorHandle>;
+};
+
+static_assert(ShapeLike<Shape>);
+
+namespace StaticAdapter
+{
+/**
+ * Lets the user manipulate a static TextShape.
+ */
+template <class S>
+class TextManipulator : public Manipulator
+{
+public:
+    TextManipulator(const S *shape) : _shape(shape) {}
+    const S *GetShape() const { return _shape; }
+
+private:
+    const S *_shape;
+};
+
+/**
+ * A class adapter like ClassAdapter::TextShape, but with no Shape base
+ * and so no virtual functions of its own. View may be any TextView
+ * subclass; since the view is part of the object its dynamic type is
+ * known, and even TextView's virtual IsEmpty is called directly.
+ */
+template <class View = TextView>
+class TextShape final : private View
+{
+public:
+    template <class... Args>
+        requires std::constructible_from<View, Args...>
+    explicit TextShape(Args &&... args) : View(std::forward<Args>(args)...) {}
+
+    void BoundingBox(Point &bottomLeft, Point &topRight) const
+    {
+        Coord bottom, left, width, height;
+        View::GetOrigin(bottom, left);
+        View::GetExtent(width, height);
+        bottomLeft = Point(bottom, left);
+        topRight = Point(bottom + height, left + width);
+    }
+
+    bool IsEmpty() const
+    {
+        return View::IsEmpty();
+    }
+
+    ManipulatorHandle CreateManipulator() const
+    {
+        return ManipulatorPool::Create<TextManipulator<TextShape> >(this);
+    }
+
+    const View &GetView() const { return *this; }
+    View &GetView() { return *this; }
+};
+
+static_assert(ShapeLike<TextShape<> >);
+} // namespace StaticAdapter
+
+/**
+ * The shape an element of a shape range stands for: the element
+ * itself, or what it points to.
+ */
+template <class T>
+const auto &ShapeOf(const T &element)
+{
+    if constexpr (std::is_pointer_v<T>)
+        return *element;
+    else
+        return element;
+}
+
+template <class Range>
+using ShapeOfRange = std::remove_cvref_t<decltype(ShapeOf(*std::begin(std::declval<const Range &>())))>;
+
+// A range of shapes, or of pointers to shapes, all of one ShapeLike type.
+template <class Range>
+concept ShapeRange = ShapeLike<ShapeOfRange<Range> >;
+
+/**
+ * The box around every shape in the range that is not empty. Returns
+ * false, leaving the points alone, if there is no such shape.
+ */
+template <ShapeRange Range>
+bool BoundsUnion(const Range &shapes, Point &bottomLeft, Point &topRight)
+{
+    bool any = false;
+    for (const auto &element : shapes)
+    {
+        const auto &shape = ShapeOf(element);
+        if (shape.IsEmpty())
+            continue;
+        Point low, high;
+        shape.BoundingBox(low, high);
+        if (!any)
+        {
+            bottomLeft = low;
+            topRight = high;
+            any = true;
+            continue;
+        }
+        bottomLeft.x = std::min(bottomLeft.x, low.x);
+        bottomLeft.y = std::min(bottomLeft.y, low.y);
+        topRight.x = std::max(topRight.x, high.x);
+        topRight.y = std::max(topRight.y, high.y);
+    }
+    return any;
+}
+
+/**
+ * The last shape in the range, the one drawn on top, whose box holds
+ * point; nullptr if none does. Empty shapes are never hit.
+ */
+template <ShapeRange Range>
+const ShapeOfRange<Range> *HitTest(const Range &shapes, const Point &point)
+{
+    const ShapeOfRange<Range> *hit = nullptr;
+    for (const auto &element : shapes)
+    {
+        const auto &shape = ShapeOf(element);
+        if (shape.IsEmpty())
+            continue;
+        Point bottomLeft, topRight;
+        shape.BoundingBox(bottomLeft, topRight);
+        if (bottomLeft.x <= point.x && point.x <= topRight.x &&
+            bottomLeft.y <= point.y && point.y <= topRight.y)
+            hit = &shape;
+    }
+    return hit;
+}
+
+#endif // STATIC_SHAPE_H
@@ -0,0 +1,105 @@
+#include <cstdio>
+#include <vector>
+#include "Check.h"
+#include "Shape.h"
+#include "StaticShape.h"
+using namespace std;
+
+/**
+ * Checks that BoundsUnion and HitTest give the same answers for a range
+ * of static text shapes as for the same shapes through Shape pointers:
+ * on a mixed range with empty shapes in it, on a range with no shapes,
+ * on one whose shapes are all empty, and for points nothing covers.
+ * Exits non-zero otherwise.
+ */
+
+struct Geometry
+{
+    Coord x, y, width, height;
+};
+
+struct Ranges
+{
+    vector<ClassAdapter::TextShape> virtualShapes;
+    vector<StaticAdapter::TextShape<> > staticShapes;
+    vector<const Shape *> pointers;
+
+    explicit Ranges(const vector<Geometry> &geometry)
+    {
+        virtualShapes.reserve(geometry.size());
+        for (const Geometry &g : geometry)
+        {
+            virtualShapes.emplace_back(g.x, g.y, g.width, g.height);
+            staticShapes.emplace_back(g.x, g.y, g.width, g.height);
+        }
+        for (const ClassAdapter::TextShape &shape : virtualShapes)
+            pointers.push_back(&shape);
+    }
+};
+
+static bool samePoint(const Point &a, const Point &b)
+{
+    return a.x == b.x && a.y == b.y;
+}
+
+static bool sameBoundsUnion(const Ranges &ranges)
+{
+    const Point untouched(-7, -7);
+    Point virtualLow = untouched, virtualHigh = untouched;
+    Point staticLow = untouched, staticHigh = untouched;
+    bool virtualAny = BoundsUnion(ranges.pointers, virtualLow, virtualHigh);
+    bool staticAny = BoundsUnion(ranges.staticShapes, staticLow, staticHigh);
+    return virtualAny == staticAny && samePoint(virtualLow, staticLow) && samePoint(virtualHigh, staticHigh);
+}
+
+// Whether both ranges hit the shape at the same index, or both miss.
+static bool sameHit(const Ranges &ranges, const Point &point)
+{
+    const Shape *virtualHit = HitTest(ranges.pointers, point);
+    const StaticAdapter::TextShape<> *staticHit = HitTest(ranges.staticShapes, point);
+    if (!virtualHit || !staticHit)
+        return !virtualHit && !staticHit;
+    return static_cast<const ClassAdapter::TextShape *>(virtualHit) - ranges.virtualShapes.data() ==
+           staticHit - ranges.staticShapes.data();
+}
+
+static bool sameHits(const Ranges &ranges)
+{
+    for (int x = -5; x < 70; x += 2)
+        for (int y = -5; y < 50; y += 3)
+            if (!sameHit(ranges, Point(Coord(x), Coord(y))))
+                return false;
+    return true;
+}
+
+int main()
+{
+    vector<Geometry> mixed;
+    for (int i = 0; i < 64; ++i)
+        mixed.push_back(Geometry{Coord(i), Coord(i % 16), Coord(i % 5), Coord(1 + i % 7)});
+    Ranges shapes(mixed);
+    check(sameBoundsUnion(shapes), "BoundsUnion agrees on a range with empty shapes in it");
+    check(sameHits(shapes), "HitTest agrees across the range and beyond it");
+    check(!HitTest(shapes.staticShapes, Point(-100, -100)) && !HitTest(shapes.pointers, Point(-100, -100)),
+          "a point no shape covers hits nothing");
+
+    Ranges none((vector<Geometry>()));
+    check(sameBoundsUnion(none), "BoundsUnion agrees on a range with no shapes");
+    Point low(-7, -7), high(-7, -7);
+    check(!BoundsUnion(none.staticShapes, low, high) && low.x == -7 && high.x == -7,
+          "BoundsUnion of no shapes returns false and leaves the points alone");
+    check(sameHits(none), "HitTest on no shapes hits nothing");
+
+    vector<Geometry> allEmpty;
+    for (int i = 0; i < 8; ++i)
+        allEmpty.push_back(Geometry{Coord(i), Coord(i), Coord(i % 2 ? 0 : 3), Coord(i % 2 ? 4 : 0)});
+    Ranges empties(allEmpty);
+    check(sameBoundsUnion(empties), "BoundsUnion agrees when every shape is empty");
+    check(!BoundsUnion(empties.pointers, low, high), "BoundsUnion of empty shapes returns false");
+    check(sameHits(empties) && !HitTest(empties.staticShapes, Point(1, 1)), "empty shapes are never hit");
+
+    if (failures)
+        return 1;
+    printf("StaticShape: static and virtual ranges agree on BoundsUnion and HitTest\n");
+    return 0;
+}
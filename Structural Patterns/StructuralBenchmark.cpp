@@ -0,0 +1,346 @@
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <new>
+#include <thread>
+#include <vector>
+#include "AnyBackpack.h"
+#include "Backpack.h"
+#include "BackpackArena.h"
+#include "BackpackChain.h"
+#include "BackpackFixtures.h"
+#include "Benchmark.h"
+#include "CachedTextShape.h"
+#include "Shape.h"
+#include "ShapeBatch.h"
+#include "ShapeIndex.h"
+#include "StaticBackpack.h"
+#include "StaticShape.h"
+#include "TextGeometry.h"
+using namespace std;
+
+/**
+ * Benchmarks for the Structural Patterns.
+ *
+ *     StructuralBenchmark [--json results.json]
+ *
+ * Prints one row per case and, with --json, also writes the results
+ * as JSON so that runs can be compared between releases. On Linux with
+ * perf events enabled each row also carries hardware counters.
+ */
+
+static void decoratorCases(BenchmarkSuite &suite)
+{
+  BackpackSink sink(4096);
+
+  for (int depth : {1, 3, 4, 16, 64})
+  {
+    BackpackChain chain = virtualChain(depth);
+    suite.run("decorator/virtual/depth=" + to_string(depth), [&] {
+      sink.clear();
+      chain->assemble(sink);
+    });
+  }
+
+  Decorated<PlainBackpack, LaptopSlot, USBCharge, WaterBottle> decorated;
+  IBackpack *staticChain = &decorated;
+  doNotOptimize(staticChain);
+  suite.run("decorator/static/depth=3", [&] {
+    sink.clear();
+    staticChain->assemble(sink);
+  });
+}
+
+template <class MakeShape>
+static void boundingBoxCase(BenchmarkSuite &suite, const string &name, MakeShape makeShape)
+{
+  const size_t Count = 1024;
+  vector<Shape *> shapes;
+  for (size_t i = 0; i < Count; ++i)
+    shapes.push_back(makeShape(Coord(i)));
+
+  size_t next = 0;
+  suite.run(name, [&] {
+    Point bottomLeft, topRight;
+    shapes[next++ & (Count - 1)]->BoundingBox(bottomLeft, topRight);
+    doNotOptimize(topRight);
+  });
+
+  for (Shape *shape : shapes)
+    delete shape;
+}
+
+static void adapterCases(BenchmarkSuite &suite)
+{
+  boundingBoxCase(suite, "adapter/class/BoundingBox", [](Coord i) -> Shape * {
+    return new ClassAdapter::TextShape(i, i, 10, 20);
+  });
+
+  vector<TextView> views;
+  views.reserve(1024);
+  boundingBoxCase(suite, "adapter/object/BoundingBox", [&](Coord i) -> Shape * {
+    views.emplace_back(i, i, 10, 20);
+    return new ObjectAdapter::TextShape(&views.back());
+  });
+
+  boundingBoxCase(suite, "adapter/cached-class/BoundingBox", [](Coord i) -> Shape * {
+    return new ClassAdapter::CachedTextShape(i, i, 10, 20);
+  });
+
+  vector<ObservableTextView> cachedViews;
+  cachedViews.reserve(1024);
+  boundingBoxCase(suite, "adapter/cached-object/BoundingBox", [&](Coord i) -> Shape * {
+    cachedViews.emplace_back(i, i, 10, 20);
+    return new ObjectAdapter::CachedTextShape(&cachedViews.back());
+  });
+
+  // The worst case for the cache: the text moves before every query.
+  ObservableTextView moving(0, 0, 10, 20);
+  ObjectAdapter::CachedTextShape watcher(&moving);
+  Coord step = 0;
+  suite.run("adapter/cached-object/move+BoundingBox", [&] {
+    moving.SetOrigin(step, step);
+    step += 1;
+    Point bottomLeft, topRight;
+    watcher.BoundingBox(bottomLeft, topRight);
+    doNotOptimize(topRight);
+  });
+
+  // Both adapters interleaved, one virtual call per shape vs. batched.
+  const size_t Count = 1024;
+  vector<TextView> mixedViews(Count / 2, TextView(0, 0, 10, 20));
+  vector<Shape *> shapes;
+  for (size_t i = 0; i < Count; ++i)
+  {
+    if (i % 2)
+      shapes.push_back(new ObjectAdapter::TextShape(&mixedViews[i / 2]));
+    else
+      shapes.push_back(new ClassAdapter::TextShape(Coord(i), Coord(i), 10, 20));
+  }
+  vector<Point> bottomLeft(Count), topRight(Count);
+
+  suite.run("adapter/mixed/BoundingBox/1024", [&] {
+    for (size_t i = 0; i < Count; ++i)
+      shapes[i]->BoundingBox(bottomLeft[i], topRight[i]);
+    doNotOptimize(topRight.data());
+  });
+
+  ShapeBatch batch(shapes.data(), shapes.size());
+  suite.run("adapter/mixed/BoundingBoxes/1024", [&] {
+    batch.BoundingBoxes(bottomLeft.data(), topRight.data());
+    doNotOptimize(topRight.data());
+  });
+
+  for (Shape *shape : shapes)
+    delete shape;
+}
+
+static void staticShapeCases(BenchmarkSuite &suite)
+{
+  // The same 1024 text shapes through Shape pointers and as static adapters.
+  const size_t Count = 1024;
+  vector<ClassAdapter::TextShape> virtualShapes;
+  vector<StaticAdapter::TextShape<> > staticShapes;
+  for (size_t i = 0; i < Count; ++i)
+  {
+    virtualShapes.emplace_back(Coord(i), Coord(i % 64), 10, 20);
+    staticShapes.emplace_back(Coord(i), Coord(i % 64), 10, 20);
+  }
+  vector<const Shape *> pointers;
+  for (const ClassAdapter::TextShape &shape : virtualShapes)
+    pointers.push_back(&shape);
+
+  Point bottomLeft, topRight;
+  suite.run("static/virtual/BoundsUnion/1024", [&] {
+    BoundsUnion(pointers, bottomLeft, topRight);
+    doNotOptimize(topRight);
+  });
+  suite.run("static/concept/BoundsUnion/1024", [&] {
+    BoundsUnion(staticShapes, bottomLeft, topRight);
+    doNotOptimize(topRight);
+  });
+
+  Point mouse(512, 40);
+  suite.run("static/virtual/HitTest/1024", [&] {
+    doNotOptimize(HitTest(pointers, mouse));
+  });
+  suite.run("static/concept/HitTest/1024", [&] {
+    doNotOptimize(HitTest(staticShapes, mouse));
+  });
+}
+
+static void geometryCases(BenchmarkSuite &suite)
+{
+  const size_t Count = 4096;
+  vector<TextView> views;
+  vector<ObjectAdapter::TextShape> shapes;
+  views.reserve(Count);
+  shapes.reserve(Count);
+  TextGeometry geometry;
+  for (size_t i = 0; i < Count; ++i)
+  {
+    views.emplace_back(Coord(i), Coord(i), 10, 20);
+    shapes.emplace_back(&views.back());
+    geometry.Add(views.back());
+  }
+  // Aligned like the geometry arrays, so that no vector store splits a cache line.
+  const align_val_t Alignment = align_val_t(TextGeometry::Alignment);
+  Point *bottomLeft = static_cast<Point *>(::operator new(Count * sizeof(Point), Alignment));
+  Point *topRight = static_cast<Point *>(::operator new(Count * sizeof(Point), Alignment));
+
+  suite.run("geometry/object/BoundingBox/4096", [&] {
+    for (size_t i = 0; i < Count; ++i)
+      shapes[i].BoundingBox(bottomLeft[i], topRight[i]);
+    doNotOptimize(topRight);
+  });
+
+  for (TextGeometry::Kernel kernel : {TextGeometry::Scalar, TextGeometry::AVX2})
+  {
+    if (!TextGeometry::Supports(kernel))
+      continue;
+    suite.run(string("geometry/soa/") + TextGeometry::KernelName(kernel) + "/4096", [&] {
+      geometry.BoundingBoxes(bottomLeft, topRight, kernel);
+      doNotOptimize(topRight);
+    });
+  }
+
+  ::operator delete(bottomLeft, Alignment);
+  ::operator delete(topRight, Alignment);
+}
+
+static void spatialCases(BenchmarkSuite &suite)
+{
+  // Text boxes scattered over a 1000 x 1000 page, by a fixed LCG.
+  const size_t Count = 100000;
+  unsigned state = 1;
+  auto next = [&](Coord scale) {
+    state = state * 1664525u + 1013904223u;
+    return Coord(state >> 8) / Coord(1 << 24) * scale;
+  };
+  vector<ClassAdapter::TextShape> shapes;
+  shapes.reserve(Count);
+  for (size_t i = 0; i < Count; ++i)
+    shapes.emplace_back(next(1000), next(1000), 1 + next(10), 1 + next(10));
+  vector<const Shape *> pointers;
+  for (const ClassAdapter::TextShape &shape : shapes)
+    pointers.push_back(&shape);
+
+  vector<Point> clicks;
+  for (int i = 0; i < 1024; ++i)
+    clicks.emplace_back(next(1000), next(1000));
+  size_t click = 0;
+
+  suite.run("spatial/linear/point/100000", [&] {
+    const Point &p = clicks[click++ & 1023];
+    size_t hits = 0;
+    for (const Shape *shape : pointers)
+    {
+      Point bottomLeft, topRight;
+      shape->BoundingBox(bottomLeft, topRight);
+      hits += bottomLeft.x <= p.x && p.x <= topRight.x && bottomLeft.y <= p.y && p.y <= topRight.y;
+    }
+    doNotOptimize(hits);
+  });
+
+  ShapeIndex index;
+  index.BulkLoad(pointers.data(), pointers.size());
+  suite.run("spatial/bvh/point/100000", [&] {
+    size_t hits = 0;
+    index.QueryPoint(clicks[click++ & 1023], [&](const Shape *) { ++hits; });
+    doNotOptimize(hits);
+  });
+
+  suite.run("spatial/bvh/rect-50x50/100000", [&] {
+    const Point &p = clicks[click++ & 1023];
+    size_t hits = 0;
+    index.QueryRect(p, Point(p.x + 50, p.y + 50), [&](const Shape *) { ++hits; });
+    doNotOptimize(hits);
+  });
+
+  size_t moved = 0;
+  suite.run("spatial/bvh/remove+insert", [&] {
+    const Shape *shape = pointers[moved++ % Count];
+    index.Remove(shape);
+    index.Insert(shape);
+  });
+
+  vector<unsigned> threadCounts(1, 1);
+  if (thread::hardware_concurrency() > 1)
+    threadCounts.push_back(thread::hardware_concurrency());
+  for (unsigned threads : threadCounts)
+    suite.runThreaded("spatial/bulk-load/100000/threads=" + to_string(threads), [&] {
+      index.BulkLoad(pointers.data(), pointers.size(), threads);
+    });
+}
+
+static void allocationCases(BenchmarkSuite &suite)
+{
+  suite.run("alloc/new-chain/depth=4", [] {
+    IBackpack *chain = new WithWaterBottle(new WithUSBCharge(new WithLaptopSlot(
+        new BackpackDecorator(new PlainBackpack()))));
+    doNotOptimize(chain);
+    destroyChain(chain);
+  });
+
+  suite.run("alloc/arena-chain/depth=4", [] {
+    ArenaChain<PlainBackpack, BackpackDecorator, WithLaptopSlot, WithUSBCharge, WithWaterBottle> chain;
+    doNotOptimize(chain);
+  });
+
+  PlainBackpack plain;
+  AnyBackpack any = WithLaptopSlot(&plain);
+  suite.run("alloc/any-backpack/copy", [&] {
+    AnyBackpack copy = any;
+    doNotOptimize(copy);
+  });
+
+  ClassAdapter::TextShape shape(0, 0, 10, 20);
+  suite.run("alloc/new-TextManipulator", [&] {
+    Manipulator *manipulator = new TextManipulator(&shape);
+    doNotOptimize(manipulator);
+    delete manipulator;
+  });
+
+  suite.run("alloc/CreateManipulator", [&] {
+    ManipulatorHandle manipulator = shape.CreateManipulator();
+    doNotOptimize(manipulator);
+  });
+}
+
+int main(int argc, char *argv[])
+{
+  const char *jsonPath = nullptr;
+  for (int i = 1; i < argc; ++i)
+  {
+    if (strcmp(argv[i], "--json") == 0 && i + 1 < argc)
+      jsonPath = argv[++i];
+    else
+    {
+      cerr << "usage: " << argv[0] << " [--json results.json]\n";
+      return 2;
+    }
+  }
+
+  BenchmarkSuite suite("structural");
+  if (!suite.hasCounters())
+    cerr << "hardware counters unavailable, reporting time only\n";
+  decoratorCases(suite);
+  adapterCases(suite);
+  staticShapeCases(suite);
+  geometryCases(suite);
+  spatialCases(suite);
+  allocationCases(suite);
+
+  if (jsonPath)
+  {
+    ofstream json(jsonPath);
+    suite.writeJson(json);
+    if (!json)
+    {
+      cerr << "could not write " << jsonPath << "\n";
+      return 1;
+    }
+  }
+  return 0;
+}
@@ -0,0 +1,203 @@
+#ifndef TEXT_GEOMETRY_H
+#define TEXT_GEOMETRY_H
+
+#include <cstddef>
+#include <cstring>
+#include <new>
+#include "Shape.h"
+
+#if (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+#include <immintrin.h>
+#define TEXT_GEOMETRY_X86 1
+#endif
+
+/**
+ * Text geometry as a structure of arrays.
+ *
+ * A TextShape computes its bounding box from a TextView that sits
+ * somewhere on the heap, one shape at a time. TextGeometry keeps the
+ * origin and extent of many text shapes in four separate arrays, x, y,
+ * width and height, each aligned to Alignment bytes. BoundingBoxes()
+ * then computes every box with the same arithmetic as
+ * TextShape::BoundingBox in one plain loop over the arrays, which the
+ * compiler is free to vectorize for the instruction set it targets.
+ *
+ *     TextGeometry geometry;
+ *     for (const TextView &view : views)
+ *         geometry.Add(view);
+ *     geometry.BoundingBoxes(bottomLeft.data(), topRight.data());
+ *
+ * BoundingBoxes(bottomLeft, topRight, kernel) runs a given kernel
+ * instead; it must be one for which Supports() is true. The AVX2
+ * kernel, eight shapes per instruction, is not the default: the loop
+ * is bound by its stores, and AVX2 is faster on some hosts and slower
+ * on others. Run StructuralBenchmark before choosing it.
+ */
+class TextGeometry
+{
+public:
+    static const std::size_t Alignment = 32;
+
+    enum Kernel
+    {
+        Scalar,
+        AVX2
+    };
+
+    static const char *KernelName(Kernel kernel)
+    {
+        static const char *const names[] = {"scalar", "avx2"};
+        return names[kernel];
+    }
+
+    static bool Supports(Kernel kernel)
+    {
+#ifdef TEXT_GEOMETRY_X86
+        switch (kernel)
+        {
+        case Scalar: return true;
+        case AVX2: return __builtin_cpu_supports("avx2");
+        }
+        return false;
+#else
+        return kernel == Scalar;
+#endif
+    }
+
+    TextGeometry() : _x(nullptr), _y(nullptr), _width(nullptr), _height(nullptr), _size(0), _capacity(0) {}
+    ~TextGeometry() { Release(); }
+
+    TextGeometry(const TextGeometry &) = delete;
+    TextGeometry &operator=(const TextGeometry &) = delete;
+
+    std::size_t Size() const { return _size; }
+
+    void Reserve(std::size_t capacity)
+    {
+        if (capacity <= _capacity)
+            return;
+        Coord *x = Allocate(capacity), *y = Allocate(capacity);
+        Coord *width = Allocate(capacity), *height = Allocate(capacity);
+        if (_size)
+        {
+            std::memcpy(x, _x, _size * sizeof(Coord));
+            std::memcpy(y, _y, _size * sizeof(Coord));
+            std::memcpy(width, _width, _size * sizeof(Coord));
+            std::memcpy(height, _height, _size * sizeof(Coord));
+        }
+        Release();
+        _x = x;
+        _y = y;
+        _width = width;
+        _height = height;
+        _capacity = capacity;
+    }
+
+    // Append a text shape and return its index.
+    std::size_t Add(Coord x, Coord y, Coord width, Coord height)
+    {
+        if (_size == _capacity)
+            Reserve(_capacity ? 2 * _capacity : 64);
+        Set(_size, x, y, width, height);
+        return _size++;
+    }
+
+    std::size_t Add(const TextView &view)
+    {
+        Coord x, y, width, height;
+        view.GetOrigin(x, y);
+        view.GetExtent(width, height);
+        return Add(x, y, width, height);
+    }
+
+    void Set(std::size_t i, Coord x, Coord y, Coord width, Coord height)
+    {
+        _x[i] = x;
+        _y[i] = y;
+        _width[i] = width;
+        _height[i] = height;
+    }
+
+    void Clear() { _size = 0; }
+
+    const Coord *X() const { return _x; }
+    const Coord *Y() const { return _y; }
+    const Coord *Width() const { return _width; }
+    const Coord *Height() const { return _height; }
+
+    // Fill bottomLeft[0, Size()) and topRight[0, Size()).
+    void BoundingBoxes(Point *bottomLeft, Point *topRight) const
+    {
+        BoundsScalar(0, bottomLeft, topRight);
+    }
+
+    void BoundingBoxes(Point *bottomLeft, Point *topRight, Kernel kernel) const
+    {
+        std::size_t done = 0;
+#ifdef TEXT_GEOMETRY_X86
+        if (kernel == AVX2)
+            done = BoundsAVX2(bottomLeft, topRight);
+#endif
+        BoundsScalar(done, bottomLeft, topRight);
+    }
+
+private:
+    static Coord *Allocate(std::size_t count)
+    {
+        return static_cast<Coord *>(::operator new(count * sizeof(Coord), std::align_val_t(Alignment)));
+    }
+
+    static void Free(Coord *p)
+    {
+        if (p)
+            ::operator delete(p, std::align_val_t(Alignment));
+    }
+
+    void Release()
+    {
+        Free(_x);
+        Free(_y);
+        Free(_width);
+        Free(_height);
+    }
+
+    // The same arithmetic as TextShape::BoundingBox, from shape `from` on.
+    void BoundsScalar(std::size_t from, Point *bottomLeft, Point *topRight) const
+    {
+        for (std::size_t i = from; i < _size; ++i)
+        {
+            bottomLeft[i] = Point(_x[i], _y[i]);
+            topRight[i] = Point(_x[i] + _height[i], _y[i] + _width[i]);
+        }
+    }
+
+#ifdef TEXT_GEOMETRY_X86
+    // Returns how many shapes it handled; the scalar loop does the rest.
+    __attribute__((target("avx2"))) std::size_t BoundsAVX2(Point *bottomLeft, Point *topRight) const
+    {
+        float *bl = reinterpret_cast<float *>(bottomLeft);
+        float *tr = reinterpret_cast<float *>(topRight);
+        std::size_t i = 0;
+        for (; i + 8 <= _size; i += 8)
+        {
+            __m256 x = _mm256_load_ps(_x + i), y = _mm256_load_ps(_y + i);
+            __m256 right = _mm256_add_ps(x, _mm256_load_ps(_height + i));
+            __m256 top = _mm256_add_ps(y, _mm256_load_ps(_width + i));
+            // unpack interleaves within each 128-bit lane; permute puts the lanes in order.
+            __m256 lo = _mm256_unpacklo_ps(x, y), hi = _mm256_unpackhi_ps(x, y);
+            _mm256_storeu_ps(bl + 2 * i, _mm256_permute2f128_ps(lo, hi, 0x20));
+            _mm256_storeu_ps(bl + 2 * i + 8, _mm256_permute2f128_ps(lo, hi, 0x31));
+            lo = _mm256_unpacklo_ps(right, top);
+            hi = _mm256_unpackhi_ps(right, top);
+            _mm256_storeu_ps(tr + 2 * i, _mm256_permute2f128_ps(lo, hi, 0x20));
+            _mm256_storeu_ps(tr + 2 * i + 8, _mm256_permute2f128_ps(lo, hi, 0x31));
+        }
+        return i;
+    }
+#endif
+
+    Coord *_x, *_y, *_width, *_height;
+    std::size_t _size, _capacity;
+};
+
+#endif // TEXT_GEOMETRY_H
@@ -0,0 +1,64 @@
+#include <cstdio>
+#include <vector>
+#include "Check.h"
+#include "Shape.h"
+#include "TextGeometry.h"
+using namespace std;
+
+/**
+ * Checks that every TextGeometry kernel this host supports gives the
+ * boxes the scalar loop gives, for sizes on both sides of a multiple of
+ * eight, where the AVX2 kernel hands the tail to the scalar loop, and
+ * that it writes nothing past Size(). Exits non-zero otherwise.
+ */
+
+static bool sameBoxes(const TextGeometry &geometry, TextGeometry::Kernel kernel)
+{
+    const size_t n = geometry.Size(), Guard = 8;
+    const Point sentinel(-1, -1);
+    vector<Point> expectedLow(n), expectedHigh(n);
+    vector<Point> low(n + Guard, sentinel), high(n + Guard, sentinel);
+    geometry.BoundingBoxes(expectedLow.data(), expectedHigh.data());
+    geometry.BoundingBoxes(low.data(), high.data(), kernel);
+
+    for (size_t i = 0; i < n; ++i)
+        if (low[i].x != expectedLow[i].x || low[i].y != expectedLow[i].y ||
+            high[i].x != expectedHigh[i].x || high[i].y != expectedHigh[i].y)
+            return false;
+    for (size_t i = n; i < n + Guard; ++i)
+        if (low[i].x != sentinel.x || low[i].y != sentinel.y || high[i].x != sentinel.x || high[i].y != sentinel.y)
+            return false;
+    return true;
+}
+
+int main()
+{
+    const size_t Sizes[] = {0, 1, 7, 8, 9, 16, 37, 4099};
+    const TextGeometry::Kernel Kernels[] = {TextGeometry::Scalar, TextGeometry::AVX2};
+
+    int ran = 0;
+    for (TextGeometry::Kernel kernel : Kernels)
+    {
+        if (!TextGeometry::Supports(kernel))
+        {
+            printf("TextGeometry: %s not supported here, skipped\n", TextGeometry::KernelName(kernel));
+            continue;
+        }
+        for (size_t size : Sizes)
+        {
+            TextGeometry geometry;
+            for (size_t i = 0; i < size; ++i)
+                geometry.Add(Coord(i) * 0.25f, Coord(i % 13) - 6.5f, Coord(1 + i % 7) * 1.5f, Coord(2 + i % 5) / 3);
+            char what[96];
+            snprintf(what, sizeof(what), "the %s kernel matches the scalar loop for %zu shapes",
+                     TextGeometry::KernelName(kernel), size);
+            check(sameBoxes(geometry, kernel), what);
+        }
+        ++ran;
+    }
+
+    if (failures)
+        return 1;
+    printf("TextGeometry: %d kernels match the scalar loop\n", ran);
+    return 0;
+}
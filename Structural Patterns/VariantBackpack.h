@@ -0,0 +1,50 @@
+#ifndef VARIANT_BACKPACK_H
+#define VARIANT_BACKPACK_H
+
+#include <variant>
+#include <vector>
+#include "Backpack.h"
+
+/**
+ * Closed-set Decorator.
+ *
+ * When the set of decorators is closed, each layer can be a value
+ * instead of a heap object behind a virtual call. A VariantBackpack is
+ * a PlainBackpack plus a vector of features, innermost first, and
+ * std::visit picks the feature's text with a switch rather than an
+ * indirect call. Unlike BackpackBatch, a feature may appear any number
+ * of times.
+ *
+ *     VariantBackpack backpack;
+ *     backpack.add(LaptopSlot()).add(USBCharge());
+ *     backpack.assemble();
+ */
+using BackpackFeature = std::variant<LaptopSlot, USBCharge, WaterBottle>;
+
+class VariantBackpack : public PlainBackpack
+{
+public:
+  VariantBackpack &add(BackpackFeature feature)
+  {
+    m_Features.push_back(feature);
+    return *this;
+  }
+
+  virtual void assemble()
+  {
+    PlainBackpack::assemble();
+    for (const BackpackFeature &feature : m_Features)
+      std::visit([](auto f) { std::cout << decltype(f)::label; }, feature);
+  }
+  virtual void assemble(BackpackSink &sink)
+  {
+    PlainBackpack::assemble(sink);
+    for (const BackpackFeature &feature : m_Features)
+      std::visit([&sink](auto f) { sink.append(decltype(f)::label); }, feature);
+  }
+
+private:
+  std::vector<BackpackFeature> m_Features;
+};
+
+#endif // VARIANT_BACKPACK_H